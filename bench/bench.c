@@ -0,0 +1,267 @@
+// Benchmark driver: runs the sudoku binary over the configurations listed in
+// configs.txt, repeating each one, and reports median and p99 wall time,
+// puzzles per second and peak resident memory. Results can be saved as a
+// baseline and later runs are compared against it; with -check the exit
+// status is 1 when a median is more than the tolerance slower.
+//
+// Usage: bench <sudoku binary> <bench directory> [-runs n] [-baseline file]
+//              [-save-baseline] [-tolerance percent] [-check]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define MAX_ARGUMENTS 128
+
+struct Config {
+    char name[64];
+    char *arguments[MAX_ARGUMENTS];  // argv of the sudoku run, arguments[0] is the binary
+    int puzzles;                     // puzzles solved per run
+};
+
+struct Result {
+    char name[64];
+    double median_ms;
+    double p99_ms;
+    double puzzles_per_sec;
+    long peak_rss_kb;
+};
+
+// Count the puzzles of a batch file the way -batch reads it: every line
+// that is neither empty nor a comment
+int count_puzzles(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open puzzle file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    char *line = NULL;
+    size_t capacity = 0;
+    int count = 0;
+    while (getline(&line, &capacity, file) != -1) {
+        if (line[0] != '\n' && line[0] != '\r' && line[0] != '#' && line[0] != '\0') count++;
+    }
+    free(line);
+    fclose(file);
+    return count;
+}
+
+// Read configs.txt into configs; returns the number of configurations
+int read_configs(const char *path, const char *sudoku, struct Config **configs) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open configuration file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    char *line = NULL;
+    size_t capacity = 0;
+    int count = 0, allocated = 0;
+    while (getline(&line, &capacity, file) != -1) {
+        char *token = strtok(line, " \t\r\n");
+        if (token == NULL || token[0] == '#') continue;
+        if (count == allocated) {
+            allocated = allocated ? allocated * 2 : 16;
+            *configs = realloc(*configs, allocated * sizeof(struct Config));
+        }
+        struct Config *config = &(*configs)[count++];
+        snprintf(config->name, sizeof(config->name), "%s", token);
+        config->puzzles = 1;
+
+        int argc = 0;
+        config->arguments[argc++] = strdup(sudoku);
+        while ((token = strtok(NULL, " \t\r\n")) != NULL && argc < MAX_ARGUMENTS - 1) {
+            config->arguments[argc++] = strdup(token);
+            if (argc >= 3 && strcmp(config->arguments[argc - 2], "-batch") == 0) config->puzzles = count_puzzles(token);
+        }
+        config->arguments[argc] = NULL;
+    }
+    free(line);
+    fclose(file);
+    return count;
+}
+
+// Run the configuration once with its output discarded; returns the wall
+// time in milliseconds and the peak resident memory of the run
+double run_once(const struct Config *config, long *peak_rss_kb) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(config->arguments[0], config->arguments);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) == -1) {
+        perror("wait4");
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Error: Configuration '%s' failed\n", config->name);
+        exit(EXIT_FAILURE);
+    }
+    *peak_rss_kb = usage.ru_maxrss;
+    return (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Find a configuration in the baseline; NULL when it was not measured
+const struct Result *find_result(const struct Result *results, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(results[i].name, name) == 0) return &results[i];
+    }
+    return NULL;
+}
+
+int read_baseline(const char *path, struct Result **results) {
+    FILE *file = fopen(path, "r");
+    if (!file) return 0;
+    char line[256];
+    int count = 0, allocated = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+        if (count == allocated) {
+            allocated = allocated ? allocated * 2 : 16;
+            *results = realloc(*results, allocated * sizeof(struct Result));
+        }
+        struct Result *result = &(*results)[count];
+        if (sscanf(line, "%63s %lf %lf %lf %ld", result->name, &result->median_ms, &result->p99_ms,
+                   &result->puzzles_per_sec, &result->peak_rss_kb) == 5) count++;
+    }
+    fclose(file);
+    return count;
+}
+
+void write_baseline(const char *path, const struct Result *results, int count) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Could not write baseline file '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(file, "# name median_ms p99_ms puzzles_per_sec peak_rss_kb\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s %.3f %.3f %.1f %ld\n", results[i].name, results[i].median_ms, results[i].p99_ms,
+                results[i].puzzles_per_sec, results[i].peak_rss_kb);
+    }
+    fclose(file);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <sudoku binary> <bench directory> [-runs n] [-baseline file] "
+                        "[-save-baseline] [-tolerance percent] [-check]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *baseline_file = "bench_baseline.txt";
+    int runs = 10, save_baseline = 0, check = 0;
+    double tolerance = 25.0;  // slowdown of the median, in percent, reported as a regression
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-runs") == 0 && i + 1 < argc) runs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-baseline") == 0 && i + 1 < argc) baseline_file = argv[++i];
+        else if (strcmp(argv[i], "-save-baseline") == 0) save_baseline = 1;
+        else if (strcmp(argv[i], "-tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "-check") == 0) check = 1;
+        else {
+            fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (runs < 1) runs = 1;
+
+    // the binary path must survive the change into the bench directory
+    char *sudoku = realpath(argv[1], NULL);
+    char *baseline_path = save_baseline ? strdup(baseline_file) : realpath(baseline_file, NULL);
+    if (sudoku == NULL) {
+        fprintf(stderr, "Error: Could not find sudoku binary '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (save_baseline && baseline_path[0] != '/') {
+        char *cwd = getcwd(NULL, 0);
+        char *absolute = malloc(strlen(cwd) + strlen(baseline_path) + 2);
+        sprintf(absolute, "%s/%s", cwd, baseline_path);
+        free(baseline_path);
+        free(cwd);
+        baseline_path = absolute;
+    }
+    if (chdir(argv[2]) != 0) {
+        fprintf(stderr, "Error: Could not enter bench directory '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    struct Config *configs = NULL;
+    int count = read_configs("configs.txt", sudoku, &configs);
+    struct Result *baseline = NULL;
+    int baseline_count = save_baseline || baseline_path == NULL ? 0 : read_baseline(baseline_path, &baseline);
+    struct Result *results = malloc(count * sizeof(struct Result));
+    double *times = malloc(runs * sizeof(double));
+    int regressions = 0;
+
+    printf("%-22s %8s %12s %12s %14s %12s %10s\n", "Configuration", "Puzzles", "Median (ms)", "p99 (ms)",
+           "Puzzles/sec", "Peak RSS KB", "vs base");
+    for (int c = 0; c < count; c++) {
+        struct Result *result = &results[c];
+        snprintf(result->name, sizeof(result->name), "%s", configs[c].name);
+        result->peak_rss_kb = 0;
+        run_once(&configs[c], &result->peak_rss_kb);  // warm-up run, not measured
+        for (int r = 0; r < runs; r++) {
+            long rss;
+            times[r] = run_once(&configs[c], &rss);
+            if (rss > result->peak_rss_kb) result->peak_rss_kb = rss;
+        }
+        qsort(times, runs, sizeof(double), compare_doubles);
+        result->median_ms = runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+        result->p99_ms = times[(99 * runs + 99) / 100 - 1];  // nearest rank
+        result->puzzles_per_sec = result->median_ms > 0 ? configs[c].puzzles * 1e3 / result->median_ms : 0;
+
+        char change[32] = "-";
+        const struct Result *base = find_result(baseline, baseline_count, result->name);
+        if (base && base->median_ms > 0) {
+            double percent = (result->median_ms / base->median_ms - 1) * 100;
+            int regressed = percent > tolerance;
+            regressions += regressed;
+            snprintf(change, sizeof(change), "%+.1f%%%s", percent, regressed ? " !" : "");
+        }
+        printf("%-22s %8d %12.3f %12.3f %14.1f %12ld %10s\n", result->name, configs[c].puzzles, result->median_ms,
+               result->p99_ms, result->puzzles_per_sec, result->peak_rss_kb, change);
+        fflush(stdout);
+    }
+
+    if (save_baseline) {
+        write_baseline(baseline_path, results, count);
+        printf("Baseline saved to '%s'\n", baseline_path);
+    } else if (baseline_count == 0) {
+        printf("No baseline found at '%s'; save one with -save-baseline\n", baseline_file);
+    } else if (regressions > 0) {
+        printf("%d configuration(s) more than %.1f%% slower than the baseline\n", regressions, tolerance);
+    }
+
+    for (int c = 0; c < count; c++) {
+        for (int i = 0; configs[c].arguments[i] != NULL; i++) free(configs[c].arguments[i]);
+    }
+    free(configs);
+    free(baseline);
+    free(results);
+    free(times);
+    free(sudoku);
+    free(baseline_path);
+    return check && regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -3,368 +3,826 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Bump arena holding the nodes and variable names of the formula being
+// converted. Chunks are kept when the arena is reset and reused in order.
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+static struct ArenaChunk* arenaFirst = NULL;
+static struct ArenaChunk* arenaCurrent = NULL;
+
+static void* arenaAllocate(size_t size) {
+    size = (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+    while (arenaCurrent && arenaCurrent->used + size > arenaCurrent->size) {
+        if (!arenaCurrent->next) break;
+        arenaCurrent = arenaCurrent->next;
+        arenaCurrent->used = 0;
+    }
+    if (!arenaCurrent || arenaCurrent->used + size > arenaCurrent->size) {
+        size_t chunkSize = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        struct ArenaChunk* chunk = (struct ArenaChunk*)malloc(sizeof(struct ArenaChunk) + chunkSize);
+        if (!chunk) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        chunk->size = chunkSize;
+        chunk->used = 0;
+        chunk->next = NULL;
+        if (arenaCurrent) {
+            // splice in before the unused rest of the list
+            chunk->next = arenaCurrent->next;
+            arenaCurrent->next = chunk;
+        } else {
+            arenaFirst = chunk;
+        }
+        arenaCurrent = chunk;
+    }
+    void* memory = (char*)arenaCurrent->data + arenaCurrent->used;
+    arenaCurrent->used += size;
+    return memory;
+}
 
-// Create a new node
-Node* createNode(char op) {
-    Node* node = (Node*)malloc(sizeof(Node) + sizeof(Node*) * 2);
-    if (!node) {
+// Hash-consing table: every distinct node is stored once, chained through
+// next in the bucket selected by its hash
+static Node** nodeBuckets = NULL;
+static int nodeBucketCount = 0;
+static int nodeCount = 0;
+
+// FNV-1a hash over the operator, the variable name and the child addresses
+static unsigned int hashNode(char op, const char* var, int varLength, Node* left, Node* right) {
+    unsigned int hash = 2166136261u;
+    hash = (hash ^ (unsigned char)op) * 16777619u;
+    for (int i = 0; i < varLength; i++) hash = (hash ^ (unsigned char)var[i]) * 16777619u;
+    hash = (hash ^ (unsigned int)((uintptr_t)left >> 4)) * 16777619u;
+    hash = (hash ^ (unsigned int)((uintptr_t)right >> 4)) * 16777619u;
+    return hash;
+}
+
+// Double the bucket array and rehash the stored nodes
+static void growNodeTable() {
+    int bucketCount = nodeBucketCount ? nodeBucketCount * 2 : 1024;
+    Node** buckets = calloc(bucketCount, sizeof(Node*));
+    if (!buckets) {
         fprintf(stderr, "Memory allocation failed\n");
         exit(EXIT_FAILURE);
     }
+    for (int i = 0; i < nodeBucketCount; i++) {
+        Node* node = nodeBuckets[i];
+        while (node) {
+            Node* next = node->next;
+            node->next = buckets[node->hash & (bucketCount - 1)];
+            buckets[node->hash & (bucketCount - 1)] = node;
+            node = next;
+        }
+    }
+    free(nodeBuckets);
+    nodeBuckets = buckets;
+    nodeBucketCount = bucketCount;
+}
+
+// Return the unique node with these fields, creating it if it is new. var
+// is the first varLength characters of a name, or NULL for operators.
+static Node* internNode(char op, const char* var, int varLength, Node* left, Node* right) {
+    if (nodeCount >= nodeBucketCount) growNodeTable();
+
+    unsigned int hash = hashNode(op, var, varLength, left, right);
+    Node** bucket = &nodeBuckets[hash & (nodeBucketCount - 1)];
+    for (Node* node = *bucket; node; node = node->next) {
+        if (node->hash == hash && node->op == op && node->left == left && node->right == right &&
+            (var ? node->var && strncmp(node->var, var, varLength) == 0 && node->var[varLength] == '\0' : !node->var)) {
+            return node;
+        }
+    }
+
+    Node* node = (Node*)arenaAllocate(sizeof(Node));
+    memset(node, 0, sizeof(Node));
     node->op = op;
-    node->var = NULL;
-    node->left = NULL;
-    node->right = NULL;
+    if (var) {
+        node->var = (char*)arenaAllocate(varLength + 1);
+        memcpy(node->var, var, varLength);
+        node->var[varLength] = '\0';
+    }
+    node->left = left;
+    node->right = right;
+    node->hash = hash;
+    node->next = *bucket;
+    *bucket = node;
+    nodeCount++;
     return node;
 }
 
-Node* createNodeFromVariable(char* var) {
-    Node* node = createNode('\0');
-    node->var = (char*)malloc(strlen(var) + 1);
-    strcpy(node->var, var);
-    return node;
+// Get the operator node with the given operands ('!' only has a left one)
+Node* createNode(char op, Node* left, Node* right) {
+    return internNode(op, NULL, 0, left, right);
 }
 
-// Deep copy a node
-Node* copyNode(Node* root) {
-    if (!root) return NULL;
+Node* createNodeFromVariable(const char* var) {
+    return internNode('\0', var, strlen(var), NULL, NULL);
+}
 
-    Node* newNode = createNode(root->op);
+// Drop every node at once, invalidating all formulas built so far. The
+// arena chunks and hash buckets are kept for the next formula.
+void resetNodeArena() {
+    if (nodeBuckets) memset(nodeBuckets, 0, nodeBucketCount * sizeof(Node*));
+    nodeCount = 0;
+    arenaCurrent = arenaFirst;
+    if (arenaCurrent) arenaCurrent->used = 0;
+}
 
-    if (root->var) {
-        newNode->var = (char*)malloc(strlen(root->var) + 1);
-        strcpy(newNode->var, root->var);
+// Release the memory of the arena and the hash buckets
+void freeNodeArena() {
+    while (arenaFirst) {
+        struct ArenaChunk* next = arenaFirst->next;
+        free(arenaFirst);
+        arenaFirst = next;
     }
+    arenaCurrent = NULL;
+    free(nodeBuckets);
+    nodeBuckets = NULL;
+    nodeBucketCount = 0;
+    nodeCount = 0;
+}
 
-    newNode->left = copyNode(root->left);
-    newNode->right = copyNode(root->right);
+// Whether a rewrite pass has already computed its result for root
+static bool isRewritten(Node* root, int pass) {
+    return root->rewrittenPasses & (1 << pass);
+}
 
-    return newNode;
+// Memoize the result of a rewrite pass for root and return it
+static Node* rewritten(Node* root, int pass, Node* result) {
+    root->rewritten[pass] = result;
+    root->rewrittenPasses |= 1 << pass;
+    return result;
 }
 
-// Remove all spaces from the expression
-void removeSpaces(char* expr) {
-    char* i = expr;
-    char* j = expr;
-    while (*j) {
-        if (*j != ' ') *i++ = *j;
-        j++;
-    }
-    *i = '\0';
+// root with its operands replaced, reusing root when they are unchanged
+static Node* withOperands(Node* root, Node* left, Node* right) {
+    if (left == root->left && right == root->right) return root;
+    return createNode(root->op, left, right);
 }
 
-Node* parseExpression(char* expr, int start, int end) {
-    // Strip outer parentheses
-    while (expr[start] == '(' && expr[end] == ')') {
-        int count = 0;
-        for (int i = start; i <= end; i++) {
-            if (expr[i] == '(') count++;
-            if (expr[i] == ')') count--;
-            if (count == 0 && i != end) break;
-            if (i == end && count == 0) {
-                start++;
-                end--;
-            }
-        }
-    }
+// Tokens of the BNF syntax
+#define TOKEN_END 0
+#define TOKEN_VARIABLE 1
+#define TOKEN_NOT 2
+#define TOKEN_AND 3
+#define TOKEN_OR 4
+#define TOKEN_IMPLIES 5
+#define TOKEN_IFF 6
+#define TOKEN_OPEN 7
+#define TOKEN_CLOSE 8
+#define TOKEN_INVALID 9
+
+// Single pass over the text with one token of lookahead
+struct Parser {
+    const char* text;
+    int position;     // first character after the current token
+    int token;        // kind of the current token
+    int tokenStart;
+    int tokenLength;
+    struct SyntaxError* error;
+};
+
+// Variable names are identifiers made of letters, digits and underscores
+static bool isIdentifierChar(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
 
-    // Handle biconditional (<=>)
-    for (int i = end, count = 0; i >= start; i--) {
-        if (expr[i] == ')') count++;
-        if (expr[i] == '(') count--;
-        if (count == 0 && expr[i] == '>' && expr[i - 1] == '=' && expr[i - 2] == '<') {
-            Node* node = createNode('<');
-            node->left = parseExpression(expr, start, i - 3);
-            node->right = parseExpression(expr, i + 1, end);
-            return node;
+// Read the next token; "v" is the or operator only as a whole word
+static void nextToken(struct Parser* parser) {
+    const char* text = parser->text;
+    int i = parser->position;
+    while (isspace((unsigned char)text[i])) i++;
+
+    parser->tokenStart = i;
+    if (text[i] == '\0') {
+        parser->token = TOKEN_END;
+    } else if (isIdentifierChar(text[i])) {
+        while (isIdentifierChar(text[i])) i++;
+        parser->token = (i - parser->tokenStart == 1 && text[parser->tokenStart] == 'v') ? TOKEN_OR : TOKEN_VARIABLE;
+    } else if (text[i] == '=' && text[i + 1] == '>') {
+        parser->token = TOKEN_IMPLIES;
+        i += 2;
+    } else if (text[i] == '<' && text[i + 1] == '=' && text[i + 2] == '>') {
+        parser->token = TOKEN_IFF;
+        i += 3;
+    } else {
+        switch (text[i]) {
+            case '!': parser->token = TOKEN_NOT; break;
+            case '^': parser->token = TOKEN_AND; break;
+            case '(': parser->token = TOKEN_OPEN; break;
+            case ')': parser->token = TOKEN_CLOSE; break;
+            default: parser->token = TOKEN_INVALID; break;
         }
+        i++;
     }
+    parser->tokenLength = i - parser->tokenStart;
+    parser->position = i;
+}
 
-    // Handle implication (=>)
-    for (int i = end, count = 0; i >= start; i--) {
-        if (expr[i] == ')') count++;
-        if (expr[i] == '(') count--;
-        if (count == 0 && expr[i] == '>' && expr[i - 1] == '=') {
-            Node* node = createNode('>');
-            node->left = parseExpression(expr, start, i - 2);
-            node->right = parseExpression(expr, i + 1, end);
-            return node;
-        }
+// Record the first syntax error, at the current token
+static Node* syntaxError(struct Parser* parser, const char* message) {
+    if (!parser->error->message) {
+        parser->error->message = message;
+        parser->error->position = parser->tokenStart;
     }
+    return NULL;
+}
 
-    // Handle disjunction (v)
-    for (int i = end, count = 0; i >= start; i--) {
-        if (expr[i] == ')') count++;
-        if (expr[i] == '(') count--;
-        if (count == 0 && expr[i] == 'v') {
-            Node* node = createNode('v');
-            node->left = parseExpression(expr, start, i - 1);
-            node->right = parseExpression(expr, i + 1, end);
-            return node;
-        }
+// Binding power of a binary operator token, 0 for other tokens. All binary
+// operators are left-associative, as in A => B => C = (A => B) => C.
+static int precedence(int token) {
+    switch (token) {
+        case TOKEN_IFF: return 1;
+        case TOKEN_IMPLIES: return 2;
+        case TOKEN_OR: return 3;
+        case TOKEN_AND: return 4;
+        default: return 0;
     }
+}
 
-    // Handle conjunction (^)
-    for (int i = end, count = 0; i >= start; i--) {
-        if (expr[i] == ')') count++;
-        if (expr[i] == '(') count--;
-        if (count == 0 && expr[i] == '^') {
-            Node* node = createNode('^');
-            node->left = parseExpression(expr, start, i - 1);
-            node->right = parseExpression(expr, i + 1, end);
-            return node;
-        }
+static char operatorOf(int token) {
+    switch (token) {
+        case TOKEN_IFF: return '<';
+        case TOKEN_IMPLIES: return '>';
+        case TOKEN_OR: return 'v';
+        default: return '^';
     }
+}
 
-    // Handle negation (!)
-    if (expr[start] == '!') {
-        if (expr[start + 1] == '(') {
-            int count = 0;
-            for (int i = start + 1; i <= end; i++) {
-                if (expr[i] == '(') count++;
-                if (expr[i] == ')') count--;
-                if (count == 0) {
-                    Node* node = createNode('!');
-                    node->left = parseExpression(expr, start + 1, i);
-                    return node;
-                }
-            }
-        } else {
-            Node* node = createNode('!');
-            node->left = parseExpression(expr, start + 1, end);
+static Node* parseBinary(struct Parser* parser, int minimumPrecedence);
+
+// operand := "!" operand | "(" formula ")" | variable
+static Node* parseOperand(struct Parser* parser) {
+    switch (parser->token) {
+        case TOKEN_NOT: {
+            nextToken(parser);
+            Node* operand = parseOperand(parser);
+            return operand ? createNode('!', operand, NULL) : NULL;
+        }
+        case TOKEN_OPEN: {
+            nextToken(parser);
+            Node* inner = parseBinary(parser, 1);
+            if (!inner) return NULL;
+            if (parser->token != TOKEN_CLOSE) return syntaxError(parser, "expected ')'");
+            nextToken(parser);
+            return inner;
+        }
+        case TOKEN_VARIABLE: {
+            Node* node = internNode('\0', parser->text + parser->tokenStart, parser->tokenLength, NULL, NULL);
+            nextToken(parser);
             return node;
         }
+        case TOKEN_INVALID:
+            return syntaxError(parser, "unexpected character");
+        default:
+            return syntaxError(parser, "expected a variable, '!' or '('");
     }
+}
 
-    // Handle complex variables (n%d_r%d_c%d)
-    if (expr[start] == 'n') {
-        char var[100];
-        int i = start, varIndex = 0;
-        while (i <= end && expr[i] != ' ') {
-            var[varIndex++] = expr[i++];
-        }
-        var[varIndex] = '\0';
-
-        return createNodeFromVariable(var);
+// Precedence climbing: parse operands joined by operators binding at least
+// as tightly as minimumPrecedence
+static Node* parseBinary(struct Parser* parser, int minimumPrecedence) {
+    Node* left = parseOperand(parser);
+    while (left && precedence(parser->token) >= minimumPrecedence) {
+        int token = parser->token;
+        nextToken(parser);
+        Node* right = parseBinary(parser, precedence(token) + 1);
+        if (!right) return NULL;
+        left = createNode(operatorOf(token), left, right);
     }
+    return left;
+}
 
-    // Handle simple variables (A, B, C, D)
-    if (start == end) {
-        return createNode(expr[start]);
+// Parse one formula in a single pass. Precedence from loosest to tightest is
+// <=>, =>, v, ^ and the prefix !. Returns NULL for an empty formula, and on
+// a syntax error, which is then described in error.
+Node* parseExpression(const char* expr, struct SyntaxError* error) {
+    struct Parser parser = {expr, 0, TOKEN_END, 0, 0, error};
+    error->message = NULL;
+    error->position = 0;
+
+    nextToken(&parser);
+    if (parser.token == TOKEN_END) return NULL;
+    Node* root = parseBinary(&parser, 1);
+    if (root && parser.token != TOKEN_END) {
+        if (parser.token == TOKEN_INVALID) return syntaxError(&parser, "unexpected character");
+        return syntaxError(&parser, parser.token == TOKEN_CLOSE ? "unmatched ')'" : "expected an operator");
     }
-
-    return NULL; // Return NULL if no match
+    return root;
 }
 
-
 // Remove biconditional nodes by converting them to equivalent implications
 Node* removeBiconditional(Node* root) {
     if (!root) return NULL;
+    if (isRewritten(root, PASS_BICONDITIONAL)) return root->rewritten[PASS_BICONDITIONAL];
 
-    root->left = removeBiconditional(root->left);
-    root->right = removeBiconditional(root->right);
+    Node* left = removeBiconditional(root->left);
+    Node* right = removeBiconditional(root->right);
 
     if (root->op == '<') {
-        Node* leftImp = createNode('>');
-        leftImp->left = copyNode(root->left);
-        leftImp->right = copyNode(root->right);
-
-        Node* rightImp = createNode('>');
-        rightImp->left = copyNode(root->right);
-        rightImp->right = copyNode(root->left);
-
-        Node* andNode = createNode('^');
-        andNode->left = leftImp;
-        andNode->right = rightImp;
-
-        free(root);
-        return andNode;
+        Node* leftImp = createNode('>', left, right);
+        Node* rightImp = createNode('>', right, left);
+        return rewritten(root, PASS_BICONDITIONAL, createNode('^', leftImp, rightImp));
     }
 
-    return root;
+    return rewritten(root, PASS_BICONDITIONAL, withOperands(root, left, right));
 }
 
 // Remove implication nodes by converting them to disjunctions
 Node* removeImplication(Node* root) {
     if (!root) return NULL;
+    if (isRewritten(root, PASS_IMPLICATION)) return root->rewritten[PASS_IMPLICATION];
 
-    root->left = removeImplication(root->left);
-    root->right = removeImplication(root->right);
+    Node* left = removeImplication(root->left);
+    Node* right = removeImplication(root->right);
 
     if (root->op == '>') {
-        Node* notNode = createNode('!');
-        notNode->left = copyNode(root->left);
-
-        Node* orNode = createNode('v');
-        orNode->left = notNode;
-        orNode->right = copyNode(root->right);
-
-        free(root);
-        return orNode;
+        Node* notNode = createNode('!', left, NULL);
+        return rewritten(root, PASS_IMPLICATION, createNode('v', notNode, right));
     }
 
-    return root;
+    return rewritten(root, PASS_IMPLICATION, withOperands(root, left, right));
 }
 
 // Apply De Morgan's laws to negate conjunctions and disjunctions
 Node* applyDeMorgan(Node* root) {
     if (!root) return NULL;
+    if (isRewritten(root, PASS_DE_MORGAN)) return root->rewritten[PASS_DE_MORGAN];
 
-    root->left = applyDeMorgan(root->left);
-    root->right = applyDeMorgan(root->right);
-
-    if (root->op == '!' && (root->left->op == 'v' || root->left->op == '^')) {
-        Node* child = root->left;
-        Node* newLeft = createNode('!');
-        newLeft->left = copyNode(child->left);
+    Node* left = applyDeMorgan(root->left);
+    Node* right = applyDeMorgan(root->right);
 
-        Node* newRight = createNode('!');
-        newRight->left = copyNode(child->right);
-
-        Node* newRoot = createNode(child->op == 'v' ? '^' : 'v');
-        newRoot->left = applyDeMorgan(newLeft);
-        newRoot->right = applyDeMorgan(newRight);
-
-        free(root);
-        free(child);
-        return newRoot;
+    if (root->op == '!' && (left->op == 'v' || left->op == '^')) {
+        Node* newLeft = applyDeMorgan(createNode('!', left->left, NULL));
+        Node* newRight = applyDeMorgan(createNode('!', left->right, NULL));
+        return rewritten(root, PASS_DE_MORGAN, createNode(left->op == 'v' ? '^' : 'v', newLeft, newRight));
     }
 
-    return root;
+    return rewritten(root, PASS_DE_MORGAN, withOperands(root, left, right));
 }
 
 // Remove double negation nodes
 Node* removeDoubleNegation(Node* root) {
     if (!root) return NULL;
+    if (isRewritten(root, PASS_DOUBLE_NEGATION)) return root->rewritten[PASS_DOUBLE_NEGATION];
 
-    root->left = removeDoubleNegation(root->left);
-    root->right = removeDoubleNegation(root->right);
+    Node* left = removeDoubleNegation(root->left);
+    Node* right = removeDoubleNegation(root->right);
 
-    if (root->op == '!' && root->left && root->left->op == '!') {
-        Node* newRoot = root->left->left;
-        free(root->left);
-        free(root);
-        return newRoot;
+    if (root->op == '!' && left && left->op == '!') {
+        return rewritten(root, PASS_DOUBLE_NEGATION, left->left);
     }
 
-    return root;
+    return rewritten(root, PASS_DOUBLE_NEGATION, withOperands(root, left, right));
+}
+
+// Whether a is the negation of the variable b
+static bool isNegationOf(Node* a, Node* b) {
+    return a->op == '!' && b->op == '\0' && a->left == b;
 }
 
 Node* distributeOrOverAnd(Node* root) {
     if (root == NULL) return NULL;
+    if (isRewritten(root, PASS_DISTRIBUTE)) return root->rewritten[PASS_DISTRIBUTE];
 
-    root->left = distributeOrOverAnd(root->left);
-    root->right = distributeOrOverAnd(root->right);
+    Node* left = distributeOrOverAnd(root->left);
+    Node* right = distributeOrOverAnd(root->right);
 
     if (root->op == 'v') {
-        if (root->left != NULL && root->left->op == '^') {
-            Node* leftAnd = root->left;
-            Node* newLeft = createNode('v');
-            newLeft->left = copyNode(leftAnd->left);
-            newLeft->right = copyNode(root->right);
-
-            Node* newRight = createNode('v');
-            newRight->left = copyNode(leftAnd->right);
-            newRight->right = copyNode(root->right);
-
-            Node* newRoot = createNode('^');
-            newRoot->left = distributeOrOverAnd(newLeft);
-            newRoot->right = distributeOrOverAnd(newRight);
-
-            free(root);
-            free(leftAnd);
-
-            return newRoot;
-        } else if (root->right != NULL && root->right->op == '^') {
-            Node* rightAnd = root->right;
-            Node* newLeft = createNode('v');
-            newLeft->left = copyNode(root->left);
-            newLeft->right = copyNode(rightAnd->left);
-
-            Node* newRight = createNode('v');
-            newRight->left = copyNode(root->left);
-            newRight->right = copyNode(rightAnd->right);
-
-            Node* newRoot = createNode('^');
-            newRoot->left = distributeOrOverAnd(newLeft);
-            newRoot->right = distributeOrOverAnd(newRight);
-
-            // 释放当前节点和合取节点
-            free(root);
-            free(rightAnd);
-
-            return newRoot;
+        if (left != NULL && left->op == '^') {
+            Node* newLeft = distributeOrOverAnd(createNode('v', left->left, right));
+            Node* newRight = distributeOrOverAnd(createNode('v', left->right, right));
+            return rewritten(root, PASS_DISTRIBUTE, createNode('^', newLeft, newRight));
+        } else if (right != NULL && right->op == '^') {
+            Node* newLeft = distributeOrOverAnd(createNode('v', left, right->left));
+            Node* newRight = distributeOrOverAnd(createNode('v', left, right->right));
+            return rewritten(root, PASS_DISTRIBUTE, createNode('^', newLeft, newRight));
+        }
+
+        // Tautologies and disjunctions with a tautology are dropped
+        if ((left && right && (isNegationOf(left, right) || isNegationOf(right, left))) || left == NULL || right == NULL) {
+            return rewritten(root, PASS_DISTRIBUTE, NULL);
         }
     }
 
-    if (root->op == 'v') {
-        if ((root->left && root->right) &&
-            ((root->left->op == '!' && root->right->op == root->left->left->op) ||
-             (root->right->op == '!' && root->left->op == root->right->left->op))) {
-            free(root);
-            return NULL;
+    return rewritten(root, PASS_DISTRIBUTE, withOperands(root, left, right));
+}
+
+
+
+void initCNFOutput(struct CNFOutput* out, struct ClauseSet* set, struct SymbolTable* symbols) {
+    out->set = set;
+    out->symbols = symbols;
+    out->auxiliaryCount = 0;
+    out->literalCount = 0;
+    out->literalCapacity = 64;
+    out->literals = malloc(out->literalCapacity * sizeof(int));
+    if (!out->literals) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void freeCNFOutput(struct CNFOutput* out) {
+    free(out->literals);
+    out->literals = NULL;
+}
+
+// Number of variables the clauses stored so far may use
+int cnfVariableCount(const struct CNFOutput* out) {
+    return out->symbols ? out->symbols->count : sudoku_size * sudoku_size * sudoku_size + out->auxiliaryCount;
+}
+
+// Variable number of a name: interned in the symbol table, or computed from
+// n{val}_r{row}_c{col} for sudoku variables
+static int variableIndex(struct CNFOutput* out, const char* name) {
+    if (out->symbols) return internSymbol(out->symbols, name, strlen(name));
+
+    int val, row, col, end = 0;
+    if (sscanf(name, "n%d_r%d_c%d%n", &val, &row, &col, &end) != 3 || name[end] != '\0' ||
+        val < 1 || val > sudoku_size || row < 1 || row > sudoku_size || col < 1 || col > sudoku_size) {
+        fprintf(stderr, "Error: Invalid token format '%s'\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return (val - 1) + (row - 1) * sudoku_size + (col - 1) * sudoku_size * sudoku_size + 1;
+}
+
+// Variable number of a new Tseitin auxiliary variable
+static int newAuxiliary(struct CNFOutput* out) {
+    int number = ++out->auxiliaryCount;
+    if (!out->symbols) return sudoku_size * sudoku_size * sudoku_size + number;
+
+    char name[16];
+    snprintf(name, sizeof(name), "%c%d", AUXILIARY_PREFIX, number);
+    return internSymbol(out->symbols, name, strlen(name));
+}
+
+// Append a literal to the clause being built
+static void pushLiteral(struct CNFOutput* out, int literal) {
+    if (out->literalCount == out->literalCapacity) {
+        out->literalCapacity *= 2;
+        out->literals = realloc(out->literals, out->literalCapacity * sizeof(int));
+        if (!out->literals) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
         }
     }
+    out->literals[out->literalCount++] = literal;
+}
 
-    if (root->op == 'v' && (root->left == NULL || root->right == NULL)) {
-        free(root);
-        return NULL;
+static void storeClause(struct CNFOutput* out, const int* literals, int size) {
+    if (addClause(out->set, literals, size, 0) == -1) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
     }
+}
 
-    return root;
+// Collect the literals of a disjunction of (negated) variables in order
+static void collectLiterals(Node* root, struct CNFOutput* out) {
+    if (!root) return;
+
+    if (root->op == '!') {
+        pushLiteral(out, -variableIndex(out, root->left->var));
+    } else if (root->op == '\0') {
+        pushLiteral(out, variableIndex(out, root->var));
+    } else {
+        collectLiterals(root->left, out);
+        collectLiterals(root->right, out);
+    }
 }
 
+// Number every variable of a formula before it is simplified, so a name that
+// only appears in a dropped tautology still becomes a (free) variable
+void internVariables(Node* root, struct CNFOutput* out) {
+    if (!root || !out->symbols) return;
 
+    if (root->op == '\0') {
+        variableIndex(out, root->var);
+    } else {
+        internVariables(root->left, out);
+        internVariables(root->right, out);
+    }
+}
 
-void treeToString(Node* root, char* buffer) {
+// Append the clauses of a formula in CNF to the clause set
+void storeCNF(Node* root, struct CNFOutput* out) {
     if (!root) return;
 
-    if (root->op == '!') {  // Handle negation
-        strcat(buffer, "!");
-        treeToString(root->left, buffer);
+    if (root->op == '^') {  // Recursively store conjunctions
+        storeCNF(root->left, out);
+        storeCNF(root->right, out);
+    } else {  // Convert and store the clause
+        out->literalCount = 0;
+        collectLiterals(root, out);
+        storeClause(out, out->literals, out->literalCount);
     }
-    else if (root->left || root->right) {  // Handle binary operations
-        treeToString(root->left, buffer);
-        int len = strlen(buffer);
+}
+
+// Store the clause made of up to three literals, 0 marks unused ones
+static void storeTseitinClause(struct CNFOutput* out, int a, int b, int c) {
+    int literals[3], size = 0;
+    if (a) literals[size++] = a;
+    if (b) literals[size++] = b;
+    if (c) literals[size++] = c;
+    storeClause(out, literals, size);
+}
+
+// Find the literal standing for root. Variables stand for themselves; every
+// operator gets a fresh auxiliary variable x. Following Plaisted-Greenbaum,
+// only the direction of x <=> root needed for the polarity root occurs in
+// is stored: x => root when positive (1), root => x when negative (-1), both
+// below a biconditional (0).
+static int tseitinLiteral(Node* root, int polarity, struct CNFOutput* out) {
+    if (root->op == '\0') return variableIndex(out, root->var);
+    if (root->op == '!') return -tseitinLiteral(root->left, -polarity, out);
+
+    // A shared subformula keeps one auxiliary variable and only gets the
+    // clauses of the directions not stored yet
+    int needed = polarity > 0 ? TSEITIN_POSITIVE : (polarity < 0 ? TSEITIN_NEGATIVE : TSEITIN_POSITIVE | TSEITIN_NEGATIVE);
+    int missing = needed & ~root->encodedPolarities;
+    if (!missing) return root->auxiliary;
+    root->encodedPolarities |= missing;
+    polarity = missing == TSEITIN_POSITIVE ? 1 : (missing == TSEITIN_NEGATIVE ? -1 : 0);
+
+    int leftPolarity = root->op == '<' ? 0 : (root->op == '>' ? -polarity : polarity);
+    int rightPolarity = root->op == '<' ? 0 : polarity;
+    int a = tseitinLiteral(root->left, leftPolarity, out);
+    int b = tseitinLiteral(root->right, rightPolarity, out);
+    if (!root->auxiliary) root->auxiliary = newAuxiliary(out);
+    int x = root->auxiliary;
+
+    switch (root->op) {
+        case '^':  // x <=> a ^ b
+            if (polarity >= 0) {
+                storeTseitinClause(out, -x, a, 0);
+                storeTseitinClause(out, -x, b, 0);
+            }
+            if (polarity <= 0) storeTseitinClause(out, x, -a, -b);
+            break;
+        case 'v':  // x <=> a v b
+            if (polarity >= 0) storeTseitinClause(out, -x, a, b);
+            if (polarity <= 0) {
+                storeTseitinClause(out, x, -a, 0);
+                storeTseitinClause(out, x, -b, 0);
+            }
+            break;
+        case '>':  // x <=> (a => b)
+            if (polarity >= 0) storeTseitinClause(out, -x, -a, b);
+            if (polarity <= 0) {
+                storeTseitinClause(out, x, a, 0);
+                storeTseitinClause(out, x, -b, 0);
+            }
+            break;
+        case '<':  // x <=> (a <=> b)
+            if (polarity >= 0) {
+                storeTseitinClause(out, -x, -a, b);
+                storeTseitinClause(out, -x, a, -b);
+            }
+            if (polarity <= 0) {
+                storeTseitinClause(out, x, a, b);
+                storeTseitinClause(out, x, -a, -b);
+            }
+            break;
+    }
+    return x;
+}
+
+// Collect the disjuncts of a top-level disjunction or implication as literals
+// of one clause, so that formulas already in clause form need no auxiliaries
+static void collectTseitinDisjuncts(Node* root, struct CNFOutput* out) {
+    if (root->op == 'v') {
+        collectTseitinDisjuncts(root->left, out);
+        collectTseitinDisjuncts(root->right, out);
+    } else if (root->op == '>') {
+        int literal = -tseitinLiteral(root->left, -1, out);
+        collectTseitinDisjuncts(root->right, out);
+        pushLiteral(out, literal);
+    } else {
+        int literal = tseitinLiteral(root, 1, out);
+        pushLiteral(out, literal);
+    }
+}
 
-        // Add operator or space for variable
-        buffer[len] = (root->op == 'v') ? ' ' : root->op;
-        buffer[len + 1] = '\0';
+// Equisatisfiable CNF of root whose size is linear in the formula: store
+// the clauses of every conjunct, introducing auxiliary variables for nested
+// operators
+void storeTseitinCNF(Node* root, struct CNFOutput* out) {
+    if (!root) return;
 
-        treeToString(root->right, buffer);
+    if (root->op == '^') {
+        storeTseitinCNF(root->left, out);
+        storeTseitinCNF(root->right, out);
+        return;
     }
-    else {  // Handle leaf nodes (either complex or simple vars)
-        if (root->op == '\0') {
-            strcat(buffer, root->var);  // Append full variable string for complex vars
+
+    out->literalCount = 0;
+    collectTseitinDisjuncts(root, out);
+    storeClause(out, out->literals, out->literalCount);
+}
+
+// Print a stored clause with variable names, as "A !B n5_r3_c2"
+void printClause(const struct CNFOutput* out, int clause) {
+    const struct ClauseSet* set = out->set;
+    int* literals = clauseLiterals(set, clause);
+    int cube = sudoku_size * sudoku_size * sudoku_size;
+
+    for (int i = 0; i < clauseSize(set, clause); i++) {
+        int variable = abs(literals[i]);
+        printf("%s%s", i > 0 ? " " : "", literals[i] < 0 ? "!" : "");
+        if (out->symbols) {
+            printf("%s", symbolName(out->symbols, variable));
+        } else if (variable > cube) {
+            printf("%c%d", AUXILIARY_PREFIX, variable - cube);
         } else {
-            int len = strlen(buffer);
-            buffer[len] = root->op;  // Append single char var
-            buffer[len + 1] = '\0';
+            printf("n%d_r%d_c%d", (variable - 1) % sudoku_size + 1, ((variable - 1) / sudoku_size) % sudoku_size + 1,
+                   (variable - 1) / (sudoku_size * sudoku_size) + 1);
         }
     }
+    printf("\n");
 }
 
-void storeCNF(Node* root, char cnfExpressions[][100], int* index) {
-    if (!root) return;
+// Order literals by variable, the negative literal first
+static int compareLiterals(const void* a, const void* b) {
+    int x = *(const int*) a, y = *(const int*) b;
+    if (abs(x) != abs(y)) return abs(x) < abs(y) ? -1 : 1;
+    return (x > y) - (x < y);
+}
 
-    if (root->op == '^') {  // Recursively store conjunctions
-        storeCNF(root->left, cnfExpressions, index);
-        storeCNF(root->right, cnfExpressions, index);
-    } else {  // Convert and store the expression
-        char buffer[100] = "";
-        treeToString(root, buffer);
-        strcpy(cnfExpressions[*index], buffer);
-        (*index)++;
+// Sort the literals of a clause and drop repeated ones; returns the new size,
+// or -1 for a tautology
+static int canonicalizeClause(int* literals, int size) {
+    qsort(literals, size, sizeof(int), compareLiterals);
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        if (kept > 0 && literals[kept - 1] == literals[i]) continue;
+        if (kept > 0 && literals[kept - 1] == -literals[i]) return -1;
+        literals[kept++] = literals[i];
     }
+    return kept;
 }
 
-bool isDuplicate(char cnfExpressions[][100], int index, char* expr) {
-    for (int i = 0; i < index; i++) {
-        if (strcmp(cnfExpressions[i], expr) == 0) return true;
+// FNV-1a hash of a literal array
+static uint32_t hashClause(const int* literals, int size) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash ^= (uint32_t) literals[i];
+        hash *= 16777619u;
     }
-    return false;
+    return hash;
 }
 
-int compareStrings(const void* a, const void* b) {
-    return strlen((char*)a) - strlen((char*)b);  // Sort by string length
+static void* allocateClauseMemory(size_t size) {
+    void* memory = malloc(size);
+    if (!memory) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+// Bring every clause into canonical form (literals sorted, no repeated
+// literal), drop tautologies and clauses already seen through a hash set,
+// and order the rest from short to long, keeping the first occurrence order
+// among clauses of the same size
+void canonicalizeClauses(struct ClauseSet* set) {
+    struct ClauseSet* unique = createClauseSet();
+    if (!unique) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Open addressing table of clause offsets in unique, -1 when empty
+    int slotCount = 1024;
+    while (slotCount < 2 * set->count) slotCount *= 2;
+    int* slots = allocateClauseMemory(slotCount * sizeof(int));
+    memset(slots, -1, slotCount * sizeof(int));
+
+    int longest = 0;
+    for (int clause = 0; clause < set->size; clause = nextClause(set, clause)) {
+        int* literals = clauseLiterals(set, clause);
+        int size = canonicalizeClause(literals, clauseSize(set, clause));
+        if (size < 0) continue;
+
+        int slot = hashClause(literals, size) & (slotCount - 1);
+        bool seen = false;
+        while (slots[slot] != -1 && !seen) {
+            int other = slots[slot];
+            seen = clauseSize(unique, other) == size &&
+                   memcmp(clauseLiterals(unique, other), literals, size * sizeof(int)) == 0;
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        if (seen) continue;
+
+        slots[slot] = unique->size;
+        if (addClause(unique, literals, size, 0) == -1) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        if (size > longest) longest = size;
+    }
+    free(slots);
+
+    // Counting sort of the arena by clause size
+    int* starts = calloc(longest + 2, sizeof(int));
+    int* arena = allocateClauseMemory((unique->size > 0 ? unique->size : 1) * sizeof(int));
+    if (!starts) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int clause = 0; clause < unique->size; clause = nextClause(unique, clause)) {
+        starts[clauseSize(unique, clause) + 1] += CLAUSE_HEADER + clauseSize(unique, clause);
+    }
+    for (int size = 1; size <= longest + 1; size++) starts[size] += starts[size - 1];
+    for (int clause = 0; clause < unique->size; clause = nextClause(unique, clause)) {
+        int length = CLAUSE_HEADER + clauseSize(unique, clause);
+        memcpy(arena + starts[clauseSize(unique, clause)], unique->arena + clause, length * sizeof(int));
+        starts[clauseSize(unique, clause)] += length;
+    }
+    free(starts);
+
+    free(set->arena);
+    free(unique->arena);
+    set->arena = arena;
+    set->size = unique->size;
+    set->capacity = unique->size > 0 ? unique->size : 1;
+    set->count = unique->count;
+    free(unique);
+}
+
+static const struct SymbolTable * sortSymbols;
+
+static int compareSymbolNames(const void* a, const void* b) {
+    return strcmp(symbolName(sortSymbols, *(const int*)a), symbolName(sortSymbols, *(const int*)b));
+}
+
+void writeSolutionToOutput(struct Solver * solver, int bnf, const struct SymbolTable * symbols) {
+    int * valuation = solver->valuation;
+    if (bnf == 1) {
+        printf("Solution:\n");
+
+        // List the assigned variables sorted by name
+        int * order = malloc((solver->variableNumber + 1) * sizeof(int));
+        int count = 0;
+        if (!order) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 1; i <= solver->variableNumber; i++) {
+            // Auxiliary variables of the Tseitin encoding are not shown
+            if (valuation[i] != -1 && symbolName(symbols, i)[0] != AUXILIARY_PREFIX) order[count++] = i;
+        }
+        sortSymbols = symbols;
+        qsort(order, count, sizeof(int), compareSymbolNames);
+
+        // Output the name and its assignment (True/False)
+        for (int i = 0; i < count; i++) {
+            printf("%s = %s\n", symbolName(symbols, order[i]), valuation[order[i]] == 1 ? "True" : "False");
+        }
+        free(order);
+    }else{
+        printf("Solution:\n");
+        int *sudoku_board = calloc(sudoku_size * sudoku_size, sizeof(int));  // Initialize an empty Sudoku board
+
+        // Tseitin auxiliaries are numbered after the sudoku variables
+        int variables = solver->variableNumber < sudoku_size * sudoku_size * sudoku_size ? solver->variableNumber : sudoku_size * sudoku_size * sudoku_size;
+        for (int i = 1; i <= variables; i++) {
+            if (valuation[i] != -1) { // If the variable has been assigned
+                // Reverse the index to val, row, col
+                int val = (i - 1) % sudoku_size + 1;
+                int row = ((i - 1) / sudoku_size) % sudoku_size + 1;
+                int col = (i - 1) / (sudoku_size * sudoku_size) + 1;
+
+                // Print the solution for each variable
+                if(solver->verbose){
+                    printf("n%d_r%d_c%d = %s\n", val, row, col, valuation[i] == 1 ? "True" : "False");
+                }
+
+                // Fill the Sudoku board if the variable is true
+                if (valuation[i] == 1) {
+                    sudoku_board[(row - 1) * sudoku_size + col - 1] = val;
+                }
+            }
+        }
+
+        // Now print the filled Sudoku board
+        int width = snprintf(NULL, 0, "%d", sudoku_size);
+        for (int i = 0; i < sudoku_size; i++) {
+            for (int j = 0; j < sudoku_size; j++) {
+                printf("%*d ", width, sudoku_board[i * sudoku_size + j]);
+            }
+            printf("\n");
+        }
+        free(sudoku_board);
+    }
 }
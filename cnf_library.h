@@ -2,29 +2,84 @@
 #define SUDOKU_CNF_LIBRARY_H
 
 #include <stdbool.h>
+#include "dpll_solver.h"
+#include "symbol_table.h"
 
-// 
+extern int sudoku_size;
+
+// First character of the names of the auxiliary variables introduced by
+// storeTseitinCNF(), which no BNF variable name can start with
+#define AUXILIARY_PREFIX '#'
+
+// First syntax error found by parseExpression()
+struct SyntaxError {
+    const char* message;  // NULL when the formula is valid
+    int position;         // offset of the offending token
+};
+
+// Rewrite passes whose results are memoized in every node
+#define PASS_BICONDITIONAL 0
+#define PASS_IMPLICATION 1
+#define PASS_DE_MORGAN 2
+#define PASS_DOUBLE_NEGATION 3
+#define PASS_DISTRIBUTE 4
+#define REWRITE_PASSES 5
+
+// Directions of a Tseitin definition stored for a node
+#define TSEITIN_POSITIVE 1
+#define TSEITIN_NEGATIVE 2
+
+// Formulas are hash-consed into a DAG: structurally equal subformulas are
+// one shared node, so nodes are never modified or copied and each rewrite
+// pass transforms every distinct subformula once. Nodes and their names
+// live in a bump arena until resetNodeArena().
 typedef struct Node {
-    char op;  // Logical operator (e.g., 'v', '^', '!', etc.)
-    char* var;  // Full variable name for complex variables (e.g., "n5_r3_c2")
+    char op;  // Logical operator (e.g., 'v', '^', '!', etc.), '\0' for variables
+    char* var;  // Variable name of any length (e.g., "A" or "n5_r3_c2")
     struct Node *left;
     struct Node *right;
+    struct Node *next;  // Next node in the same hash bucket
+    unsigned int hash;
+    struct Node *rewritten[REWRITE_PASSES];  // Memoized result of each pass
+    unsigned char rewrittenPasses;  // Bit per pass whose result is memoized
+    unsigned char encodedPolarities;  // TSEITIN_* directions already stored
+    int auxiliary;  // Tseitin auxiliary variable number, 0 if none
 } Node;
 
 // 
-Node* createNode(char op);
-Node* createNodeFromVariable(char* var);
-Node* parseExpression(char* expr, int start, int end);
+Node* createNode(char op, Node* left, Node* right);
+Node* createNodeFromVariable(const char* var);
+void resetNodeArena();
+void freeNodeArena();
+Node* parseExpression(const char* expr, struct SyntaxError* error);
 Node* removeBiconditional(Node* root);
 Node* removeImplication(Node* root);
 Node* applyDeMorgan(Node* root);
 Node* removeDoubleNegation(Node* root);
 Node* distributeOrOverAnd(Node* root);
-void storeCNF(Node* root, char cnfExpressions[][100], int* index);
-bool isDuplicate(char cnfExpressions[][100], int index, char* expr);
-void treeToString(Node* root, char* buffer);
-void removeSpaces(char* expr);
-int compareStrings(const void* a, const void* b);
+
+// Destination of converted formulas: clauses are appended to set as
+// integer literals
+struct CNFOutput {
+    struct ClauseSet* set;
+    struct SymbolTable* symbols;  // Interns variable names, NULL for n{val}_r{row}_c{col} sudoku variables
+    int auxiliaryCount;  // Tseitin auxiliaries created so far
+    int* literals;  // Clause being built
+    int literalCount;
+    int literalCapacity;
+};
+
+void initCNFOutput(struct CNFOutput* out, struct ClauseSet* set, struct SymbolTable* symbols);
+void freeCNFOutput(struct CNFOutput* out);
+int cnfVariableCount(const struct CNFOutput* out);
+void internVariables(Node* root, struct CNFOutput* out);
+void storeCNF(Node* root, struct CNFOutput* out);
+void storeTseitinCNF(Node* root, struct CNFOutput* out);
+void printClause(const struct CNFOutput* out, int clause);
+void canonicalizeClauses(struct ClauseSet* set);
+
+// Print the model by variable name, or as a sudoku board without symbols
+void writeSolutionToOutput(struct Solver* solver, int bnf, const struct SymbolTable* symbols);
 
 
 #endif //SUDOKU_CNF_LIBRARY_H
@@ -0,0 +1,206 @@
+#include "dimacs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Cursor over the mapped file
+struct DimacsScanner {
+    const char * next;
+    const char * end;
+    int line;
+};
+
+// skips blanks and line breaks, counting lines
+static void skipWhitespace(struct DimacsScanner * scanner) {
+    while (scanner->next < scanner->end) {
+        char c = *scanner->next;
+        if (c == '\n') scanner->line++;
+        else if (c != ' ' && c != '\t' && c != '\r') return;
+        scanner->next++;
+    }
+}
+
+static void skipLine(struct DimacsScanner * scanner) {
+    const char * newline = memchr(scanner->next, '\n', scanner->end - scanner->next);
+    scanner->next = newline != NULL ? newline : scanner->end;
+}
+
+// parses a signed decimal integer in place; returns 0 if there is none or it overflows
+static int scanInteger(struct DimacsScanner * scanner, int * value) {
+    const char * p = scanner->next;
+    int negative = 0;
+    long long result = 0;
+
+    if (p < scanner->end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p == scanner->end || *p < '0' || *p > '9') return 0;
+    while (p < scanner->end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p++ - '0');
+        if (result > INT_MAX) return 0;
+    }
+    // a number must end at whitespace
+    if (p < scanner->end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') return 0;
+
+    scanner->next = p;
+    *value = negative ? (int) -result : (int) result;
+    return 1;
+}
+
+// parses "p cnf <variables> <clauses>"
+static int scanHeader(struct DimacsScanner * scanner, int * numVariables, int * numClauses) {
+    scanner->next++;
+    if (scanner->next < scanner->end && *scanner->next != ' ' && *scanner->next != '\t') return 0;
+    while (scanner->next < scanner->end && (*scanner->next == ' ' || *scanner->next == '\t')) scanner->next++;
+    if (scanner->end - scanner->next < 3 || memcmp(scanner->next, "cnf", 3) != 0) return 0;
+    scanner->next += 3;
+    while (scanner->next < scanner->end && (*scanner->next == ' ' || *scanner->next == '\t')) scanner->next++;
+    if (!scanInteger(scanner, numVariables) || *numVariables < 0) return 0;
+    while (scanner->next < scanner->end && (*scanner->next == ' ' || *scanner->next == '\t')) scanner->next++;
+    if (!scanInteger(scanner, numClauses) || *numClauses < 0) return 0;
+    return 1;
+}
+
+static int parseDimacs(struct DimacsScanner * scanner, struct ClauseSet * set, int * numVariables, int * numClauses,
+                       int * errorLine) {
+    int header = 0;
+    int * literals = NULL;
+    int size = 0, capacity = 0;
+
+    *numVariables = 0;
+    *numClauses = 0;
+    for (;;) {
+        skipWhitespace(scanner);
+        if (scanner->next == scanner->end) break;
+
+        char c = *scanner->next;
+        if (c == 'c') {
+            skipLine(scanner);
+            continue;
+        }
+        if (c == '%') break;  // SATLIB end marker
+        if (c == 'p') {
+            if (header || size > 0 || !scanHeader(scanner, numVariables, numClauses)) goto syntaxError;
+            header = 1;
+            continue;
+        }
+
+        int literal;
+        if (!header || !scanInteger(scanner, &literal)) goto syntaxError;
+        if (literal == 0) {
+            if (addClause(set, literals, size, 0) == -1) goto memoryError;
+            size = 0;
+            continue;
+        }
+        if (literal == INT_MIN || abs(literal) > *numVariables) goto syntaxError;
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            int * grown = realloc(literals, capacity * sizeof(int));
+            if (grown == NULL) goto memoryError;
+            literals = grown;
+        }
+        literals[size++] = literal;
+    }
+
+    // tolerate a missing terminator after the last clause
+    if (size > 0 && addClause(set, literals, size, 0) == -1) goto memoryError;
+    if (!header) goto syntaxError;
+    free(literals);
+    return SOLVER_OK;
+
+syntaxError:
+    *errorLine = scanner->line;
+    free(literals);
+    return SOLVER_ERROR;
+memoryError:
+    *errorLine = 0;
+    errno = ENOMEM;
+    free(literals);
+    return SOLVER_ERROR;
+}
+
+// reads a stream that cannot be mapped, e.g. a pipe, into one buffer
+static char * readStream(int fd, size_t * length) {
+    size_t size = 0, capacity = 1 << 16;
+    char * buffer = malloc(capacity);
+    if (buffer == NULL) return NULL;
+    for (;;) {
+        if (size == capacity) {
+            char * grown = realloc(buffer, capacity * 2);
+            if (grown == NULL) {
+                free(buffer);
+                return NULL;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t count = read(fd, buffer + size, capacity - size);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            free(buffer);
+            return NULL;
+        }
+        if (count == 0) break;
+        size += count;
+    }
+    *length = size;
+    return buffer;
+}
+
+int readDimacsFile(const char * path, struct ClauseSet * set, int * numVariables, int * numClauses, int * errorLine) {
+    struct stat info;
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    *errorLine = 0;
+    if (fd < 0) return SOLVER_ERROR;
+    if (fstat(fd, &info) != 0) {
+        if (fd != STDIN_FILENO) close(fd);
+        return SOLVER_ERROR;
+    }
+
+    char * text = NULL;
+    size_t length = 0;
+    int mapped = 0;
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        length = info.st_size;
+        text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) text = NULL;
+        else {
+            mapped = 1;
+            madvise(text, length, MADV_SEQUENTIAL);
+        }
+    }
+    if (text == NULL && !(S_ISREG(info.st_mode) && info.st_size == 0)) {
+        text = readStream(fd, &length);
+        if (text == NULL) {
+            if (fd != STDIN_FILENO) close(fd);
+            return SOLVER_ERROR;
+        }
+    }
+    if (fd != STDIN_FILENO) close(fd);
+
+    struct DimacsScanner scanner = { text, text + length, 1 };
+    int result = parseDimacs(&scanner, set, numVariables, numClauses, errorLine);
+
+    if (mapped) munmap(text, length);
+    else free(text);
+    return result;
+}
+
+int writeDimacs(FILE * out, const struct ClauseSet * set, int numVariables) {
+    int problemClauses = 0;
+    for (int clause = 0; clause < set->size; clause = nextClause(set, clause)) {
+        if (!(clauseFlags(set, clause) & CLAUSE_LEARNT)) problemClauses++;
+    }
+
+    fprintf(out, "p cnf %d %d\n", numVariables, problemClauses);
+    for (int clause = 0; clause < set->size; clause = nextClause(set, clause)) {
+        if (clauseFlags(set, clause) & CLAUSE_LEARNT) continue;
+        int * literals = clauseLiterals(set, clause);
+        for (int i = 0; i < clauseSize(set, clause); i++) fprintf(out, "%d ", literals[i]);
+        fprintf(out, "0\n");
+    }
+    return ferror(out) ? SOLVER_ERROR : SOLVER_OK;
+}
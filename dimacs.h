@@ -0,0 +1,20 @@
+#ifndef SUDOKU_DIMACS_H
+#define SUDOKU_DIMACS_H
+
+#include <stdio.h>
+#include "dpll_solver.h"
+
+// DIMACS CNF input and output. Reading maps the file into memory and
+// tokenizes it in place, appending every clause straight to a clause set.
+// Both functions return SOLVER_OK or SOLVER_ERROR and never exit.
+
+// Reads a "p cnf" file into set and stores the declared variable and clause
+// counts in numVariables and numClauses; the caller compares the latter with
+// the clauses actually read. On a syntax error errorLine holds the offending
+// line; it is 0 when the file itself could not be read (errno tells why).
+int readDimacsFile(const char * path, struct ClauseSet * set, int * numVariables, int * numClauses, int * errorLine);
+
+// Writes the problem clauses of set (learned clauses are skipped) in DIMACS format
+int writeDimacs(FILE * out, const struct ClauseSet * set, int numVariables);
+
+#endif //SUDOKU_DIMACS_H
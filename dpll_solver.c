@@ -2,81 +2,96 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
-#define SATISFIABLE 1
-#define UNSATISFIABLE -1
 #define UNCERTAIN 0
 
-int dpll(struct Clause* root);
-struct Clause* readClauseSetFromInput(char cnf[][100], int numClauses, int bnf);
-void removeClause(struct Clause* root);
-void writeSolutionToOutput(struct Clause* root, int* valuation, int bnf);
-
-int clauseNumber, variableNumber;
-int* valuation;
-int hard_case = 0;
-
-// Create and return an empty Clause
-struct Clause* createClause() {
-    struct Clause* instance = malloc(sizeof(struct Clause));
-    instance->head = NULL;
-    instance->next = NULL;
-    return instance;
+int dpll(struct Solver* solver, struct ClauseSet* set);
+
+// Create and return an empty clause set
+struct ClauseSet* createClauseSet() {
+    struct ClauseSet* set = malloc(sizeof(struct ClauseSet));
+    if (set == NULL) return NULL;
+    set->capacity = 1024;
+    set->arena = malloc(set->capacity * sizeof(int));
+    if (set->arena == NULL) {
+        free(set);
+        return NULL;
+    }
+    set->size = 0;
+    set->count = 0;
+    return set;
 }
 
-void freeClause(struct Clause *clause) {
-    if (clause == NULL) return;
-
-    // Free all literals in the clause
-    struct Literal *currentLiteral = clause->head;
-    while (currentLiteral != NULL) {
-        struct Literal *nextLiteral = currentLiteral->next;
-        free(currentLiteral); // Free the current literal
-        currentLiteral = nextLiteral; // Move to the next literal
+// Append a clause to the arena and return its offset, or -1 if the arena cannot grow
+int addClause(struct ClauseSet* set, const int* literals, int size, int flags) {
+    if (set->size + CLAUSE_HEADER + size > set->capacity) {
+        int capacity = set->capacity;
+        while (set->size + CLAUSE_HEADER + size > capacity) capacity *= 2;
+        int* arena = realloc(set->arena, capacity * sizeof(int));
+        if (arena == NULL) return -1;
+        set->arena = arena;
+        set->capacity = capacity;
     }
-
-    // Free the clause itself
-    free(clause);
+    int offset = set->size;
+    set->arena[offset] = size;
+    set->arena[offset + 1] = flags;
+    memcpy(set->arena + offset + CLAUSE_HEADER, literals, size * sizeof(int));
+    set->size += CLAUSE_HEADER + size;
+    set->count++;
+    return offset;
 }
 
-void printClauseSet(struct Clause * root){
-    struct Clause* itr = root;
-    while (itr != NULL){
-        struct Literal * l = itr->head;
-        while (l != NULL){
-            printf("%d ", l->index);
-            l = l->next;
-        }
-        printf("\n");
-        itr = itr->next;
+// Create an independent copy of a clause set
+struct ClauseSet* copyClauseSet(const struct ClauseSet* set) {
+    struct ClauseSet* copy = malloc(sizeof(struct ClauseSet));
+    if (copy == NULL) return NULL;
+    copy->capacity = set->capacity;
+    copy->arena = malloc(copy->capacity * sizeof(int));
+    if (copy->arena == NULL) {
+        free(copy);
+        return NULL;
     }
+    memcpy(copy->arena, set->arena, set->size * sizeof(int));
+    copy->size = set->size;
+    copy->count = set->count;
+    return copy;
 }
 
+// Drop every clause appended after the set held `count` clauses in `size` ints
+void truncateClauseSet(struct ClauseSet* set, int size, int count) {
+    set->size = size;
+    set->count = count;
+}
 
+// Drop every clause that mentions variable, keeping the others in order
+void removeClausesWith(struct ClauseSet* set, int variable) {
+    int size = 0, count = 0;
+    for (int c = 0; c < set->size; c = nextClause(set, c)) {
+        int mentions = 0;
+        for (int i = 0; i < clauseSize(set, c) && !mentions; i++) mentions = abs(clauseLiterals(set, c)[i]) == variable;
+        if (mentions) continue;
+        memmove(set->arena + size, set->arena + c, (CLAUSE_HEADER + clauseSize(set, c)) * sizeof(int));
+        size += CLAUSE_HEADER + clauseSize(set, c);
+        count++;
+    }
+    truncateClauseSet(set, size, count);
+}
 
-// Create and return an empty Literal
-struct Literal* createLiteral() {
-    struct Literal* instance = malloc(sizeof(struct Literal));
-    instance->next = NULL;
-    instance->index = 0;
-    return instance;
+void freeClauseSet(struct ClauseSet* set) {
+    if (set == NULL) return;
+    free(set->arena);
+    free(set);
 }
 
-// finds a unit clause and return its literal index for unit-propagation step
-int findUnitClause(struct Clause * root){
-    struct Clause * itr = root;
-    while (itr != NULL){
-        if (itr->head == NULL) {
-            if (verbose) printf("Contradiction: Empty clause found\n");
-            continue;
-        }
-        if(itr->head->next == NULL){
-            return itr->head->index;
+void printClauseSet(struct ClauseSet * set){
+    for (int c = 0; c < set->size; c = nextClause(set, c)){
+        int * literals = clauseLiterals(set, c);
+        for (int i = 0; i < clauseSize(set, c); i++){
+            printf("%d ", literals[i]);
         }
-        itr = itr->next;
+        printf("\n");
     }
-    // no unit clause found, return 0
-    return 0;
 }
 
 // signal function
@@ -84,422 +99,806 @@ int sign(int num){
     return (num > 0) - (num < 0);
 }
 
-// finds a pure literal by iterating through all clauses
-int findPureLiteral(struct Clause * root){
-    // create a lookup table to keep track of literal pureness
-    int * literalLookup = (int*) calloc(variableNumber + 1, sizeof(int));
-    struct Clause * itr = root;
-    while (itr != NULL){
-        struct Literal * l = itr->head;
-        while (l != NULL){
-            int seen = literalLookup[abs(l->index)];
-            if (seen == 0) literalLookup[abs(l->index)] = sign(l->index);
-            else if (seen == -1 && sign(l->index) == 1) literalLookup[abs(l->index)] = 2;
-            else if (seen == 1 && sign(l->index) == -1) literalLookup[abs(l->index)] = 2;
-            l = l->next;
-        }
-        itr = itr->next;
+// Grow every per-variable array of a solver to hold variables 1..numVariables.
+// Returns SOLVER_ERROR if an allocation fails, leaving the solver usable at its old size
+int reserveVariables(struct Solver* solver, int numVariables) {
+    int old = solver->variableNumber + 1, n = numVariables + 1;
+    if (numVariables <= solver->variableNumber && solver->valuation != NULL) return SOLVER_OK;
+
+    // reallocate one array and zero its new tail
+#define GROW(field, count, oldCount) do { \
+        void* grown = realloc(solver->field, (count) * sizeof(*solver->field)); \
+        if (grown == NULL) return SOLVER_ERROR; \
+        solver->field = grown; \
+        memset(solver->field + (oldCount), 0, ((count) - (oldCount)) * sizeof(*solver->field)); \
+    } while (0)
+    if (solver->valuation == NULL) old = 0;
+    GROW(valuation, n, old);
+    GROW(assignment, n, old);
+    GROW(trail, n, old);
+    GROW(trailLimit, n + 1, old == 0 ? 0 : old + 1);
+    GROW(flipped, n + 1, old == 0 ? 0 : old + 1);
+    GROW(level, n, old);
+    GROW(reason, n, old);
+    GROW(seen, n, old);
+    GROW(occurs, n, old);
+    GROW(learnt, n, old);
+    GROW(activity, n, old);
+    GROW(heap, n, old);
+    GROW(heapPosition, n, old);
+    GROW(polarity, n, old);
+    GROW(watches, 2 * n, 2 * old);
+#undef GROW
+    for (int i = old; i < n; i++) solver->valuation[i] = solver->assignment[i] = -1;
+    solver->variableNumber = numVariables;
+    return SOLVER_OK;
+}
+
+// Create a solver for variables 1..numVariables with default options, or
+// NULL if memory runs out
+struct Solver* createSolver(int numVariables) {
+    struct Solver* solver = calloc(1, sizeof(struct Solver));
+    if (solver == NULL) return NULL;
+    solver->heuristic = HEURISTIC_FIRST;
+    solver->restartInterval = RESTART_INTERVAL;
+    if (reserveVariables(solver, numVariables) != SOLVER_OK) {
+        freeSolver(solver);
+        return NULL;
     }
+    return solver;
+}
 
-    // iterate over the lookup table to send the first pure literal found
-    int i;
-    for (i = 1; i < variableNumber + 1; i++) {
-        if (literalLookup[i] == -1 || literalLookup[i] == 1) return i * literalLookup[i];
+void freeSolver(struct Solver* solver) {
+    if (solver == NULL) return;
+    if (solver->watches != NULL) {
+        for (int i = 0; i < 2 * (solver->variableNumber + 1); i++) free(solver->watches[i].clauses);
     }
-    // no pure literal found, return 0
-    return 0;
+    free(solver->watches);
+    free(solver->valuation);
+    free(solver->assignment);
+    free(solver->trail);
+    free(solver->trailLimit);
+    free(solver->flipped);
+    free(solver->level);
+    free(solver->reason);
+    free(solver->seen);
+    free(solver->occurs);
+    free(solver->learnt);
+    free(solver->activity);
+    free(solver->heap);
+    free(solver->heapPosition);
+    free(solver->polarity);
+    free(solver->failed);
+    free(solver->projection);
+    free(solver);
 }
 
-int unitPropagation(struct Clause **root){
-    int unitLiteralIndex = findUnitClause(*root);
-    if (verbose && unitLiteralIndex != 0 && hard_case!=1) printf("Easy case: Unit literal %d\n", abs(unitLiteralIndex));
-    hard_case = 0;
-    if (unitLiteralIndex == 0) return 0;
+// returns 1 if the literal is true, 0 if false and -1 if unassigned
+int literalValue(struct Solver * s, int literal){
+    int value = s->assignment[abs(literal)];
+    if (value == -1) return -1;
+    return literal > 0 ? value : !value;
+}
 
-    valuation[abs(unitLiteralIndex)] = unitLiteralIndex > 0 ? 1 : 0;
+// records a literal as true on the trail together with its implying clause
+void assignLiteral(struct Solver * s, int literal, int from){
+    s->assignment[abs(literal)] = literal > 0 ? 1 : 0;
+    s->level[abs(literal)] = s->decisionLevel;
+    s->reason[abs(literal)] = from;
+    s->trail[s->trailSize++] = literal;
+}
 
-    struct Clause *itr = *root;
-    struct Clause *prev = NULL;
-    while (itr != NULL){
-        struct Literal *currentL = itr->head;
-        struct Literal *previousL = NULL;
+// opens a new decision level with the given literal
+void decide(struct Solver * s, int literal, int isFlipped){
+    s->decisionLevel++;
+    s->trailLimit[s->decisionLevel] = s->trailSize;
+    s->flipped[s->decisionLevel] = isFlipped;
+    assignLiteral(s, literal, -1);
+    SOLVER_STAT(s->stats.decisions++);
+    SOLVER_STAT(if (s->decisionLevel > s->stats.maxDepth) s->stats.maxDepth = s->decisionLevel);
+}
 
-        int clauseRemoved = 0;
-        while (currentL != NULL){
-            if (currentL->index == unitLiteralIndex) {
-                if (prev == NULL){
-                    *root = itr->next;
-                    freeClause(itr);
-                    itr = *root;
-                } else {
-                    prev->next = itr->next;
-                    freeClause(itr);
-                    itr = prev->next;
-                }
-                clauseRemoved = 1;
-                break;
-            } else if (currentL->index == -unitLiteralIndex) {
-                if (currentL == itr->head) {
-                    itr->head = currentL->next;
-                    free(currentL);
-                    currentL = itr->head;
-                } else {
-                    previousL->next = currentL->next;
-                    free(currentL);
-                    currentL = previousL->next;
-                }
-                continue;
-            }
-            previousL = currentL;
-            currentL = currentL->next;
-        }
-        if (!clauseRemoved) {
-            prev = itr;
-            itr = itr->next;
-        }
+void heapInsert(struct Solver * s, int variable);
+
+// undoes every assignment made above the given decision level
+void backtrack(struct Solver * s, int targetLevel){
+    if (s->decisionLevel <= targetLevel) return;
+    SOLVER_STAT(s->stats.backtracks += s->decisionLevel - targetLevel);
+    while (s->trailSize > s->trailLimit[targetLevel + 1]) {
+        int variable = abs(s->trail[--s->trailSize]);
+        if (s->heuristic == HEURISTIC_VSIDS) s->polarity[variable] = s->assignment[variable];
+        s->assignment[variable] = -1;
+        if (s->heuristic != HEURISTIC_FIRST) heapInsert(s, variable);
     }
-    return 1;
+    s->propagationHead = s->trailSize;
+    s->decisionLevel = targetLevel;
 }
 
+// maps a literal to its slot in the watch table
+int watchIndex(int literal){
+    return 2 * abs(literal) + (literal < 0);
+}
 
+// Returns SOLVER_ERROR if the watch list cannot grow, leaving it unchanged
+int addWatch(struct Solver * s, int literal, int clause){
+    struct WatchList * list = &s->watches[watchIndex(literal)];
+    if (list->size == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        int * clauses = realloc(list->clauses, capacity * sizeof(int));
+        if (clauses == NULL) return SOLVER_ERROR;
+        list->clauses = clauses;
+        list->capacity = capacity;
+    }
+    list->clauses[list->size++] = clause;
+    return SOLVER_OK;
+}
 
-// implements pure literal elimination algorithm
-int pureLiteralElimination(struct Clause * root){
-    int pureLiteralIndex = findPureLiteral(root);
-    if (verbose && pureLiteralIndex != 0) printf("Easy case: Pure literal found %d\n", pureLiteralIndex);
-    if (pureLiteralIndex == 0) return 0;
-
-    // set the valuation for that literal
-    if (verbose) printf("Setting literal %d to %s\n", abs(pureLiteralIndex), pureLiteralIndex > 0 ? "true" : "false");
-    valuation[abs(pureLiteralIndex)] = pureLiteralIndex > 0 ? 1 : 0;
-
-    // iterate over the clause set to remove clauses containing the pure literal
-    struct Clause * itr = root;
-    struct Clause * prev;
-    while (itr != NULL){
-        struct Literal * l = itr->head;
-        while (l != NULL){
-            if (l->index == pureLiteralIndex) {
-                // pure literal found, remove whole clause and re-adjust pointers
-
-                if (itr == root){
-                    // the root has to change if we are removing the first clause
-                    *root = *(root->next);
-                    itr = NULL;
-                } else {
-                    prev->next = itr->next;
-                    itr = prev;
-                }
+// attaches the initial watches of the clauses from offset first on, at
+// decision level 0. Literals already false there are never watched, so a
+// clause with one literal left assigns it and one with none is a conflict.
+// Returns UNSATISFIABLE on an empty or falsified clause and SOLVER_ERROR
+// when memory runs out
+int attachClauses(struct Solver * s, int first){
+    struct ClauseSet * set = s->clauses;
+    int solution = UNCERTAIN;
+    for (int c = first; c < set->size; c = nextClause(set, c)) {
+        int * literals = clauseLiterals(set, c);
+        int size = clauseSize(set, c);
+        for (int i = 0; i < size; i++) s->occurs[abs(literals[i])] = 1;
+        if (size == 0) {
+            if (s->verbose) printf("Contradiction: Empty clause found\n");
+            solution = UNSATISFIABLE;
+            continue;
+        }
+        for (int w = 0; w < 2 && w < size; w++) {
+            if (literalValue(s, literals[w]) != 0) continue;
+            for (int k = w + 1; k < size; k++) {
+                if (literalValue(s, literals[k]) == 0) continue;
+                int swap = literals[w];
+                literals[w] = literals[k];
+                literals[k] = swap;
                 break;
             }
-            l = l->next;
         }
-        prev = itr;
-        itr = itr == NULL ? root : itr->next;
+        int value = literalValue(s, literals[0]);
+        if (value == 0) solution = UNSATISFIABLE;
+        else if (value == -1 && (size == 1 || literalValue(s, literals[1]) == 0)) {
+            if (s->verbose) printf("Easy case: Unit literal %d\n", abs(literals[0]));
+            assignLiteral(s, literals[0], size == 1 ? -1 : c);
+        }
+        if (size > 1 && (addWatch(s, literals[0], c) != SOLVER_OK || addWatch(s, literals[1], c) != SOLVER_OK)) {
+            return SOLVER_ERROR;
+        }
     }
-    return 1;
+    return solution;
 }
 
+// processes the propagation queue, visiting only the clauses that watch the
+// negation of each newly assigned literal. Returns UNSATISFIABLE on a
+// conflict and SOLVER_ERROR when a watch list cannot grow
+int unitPropagation(struct Solver * s){
+    while (s->propagationHead < s->trailSize) {
+        int falseLiteral = -s->trail[s->propagationHead++];
+        struct WatchList * list = &s->watches[watchIndex(falseLiteral)];
+        int i = 0, j = 0;
+        while (i < list->size) {
+            int clause = list->clauses[i++];
+            int * literals = clauseLiterals(s->clauses, clause);
+            int size = clauseSize(s->clauses, clause);
+
+            // keep the false watch in the second slot
+            if (literals[0] == falseLiteral) {
+                literals[0] = literals[1];
+                literals[1] = falseLiteral;
+            }
+            if (literalValue(s, literals[0]) == 1) {
+                list->clauses[j++] = clause;
+                continue;
+            }
 
+            // look for a replacement watch that is not false
+            int k = 2;
+            while (k < size && literalValue(s, literals[k]) == 0) k++;
+            if (k < size) {
+                literals[1] = literals[k];
+                literals[k] = falseLiteral;
+                if (addWatch(s, literals[1], clause) == SOLVER_OK) continue;
+
+                // out of memory: keep the remaining watches and give up
+                list->clauses[j++] = clause;
+                while (i < list->size) list->clauses[j++] = list->clauses[i++];
+                list->size = j;
+                return SOLVER_ERROR;
+            }
 
-// checks if all the remaining clauses contain non-conflicting literals
-// i.e. for each literal remaining in the clause set, either positive or
-// negative index should be present. If that's the case, satisfiability is solved.
-int areAllClausesUnit(struct Clause * root){
-//    printf("reached\n");
-    int * literalLookup = (int*) calloc(variableNumber + 1, sizeof(int));
-
-    struct Clause* itr = root;
-    while (itr != NULL){
-        struct Literal * l = itr->head;
-        while (l != NULL){
-            int seen = literalLookup[abs(l->index)];
-            if (seen == 0) literalLookup[abs(l->index)] = sign(l->index);
-                // if we previously have seen this literal with the opposite sign, return false
-            else if (seen == -1 && sign(l->index) == 1) return 0;
-            else if (seen == 1 && sign(l->index) == -1) return 0;
-            l = l->next;
+            list->clauses[j++] = clause;
+            if (literalValue(s, literals[0]) == 0) {
+                if (s->verbose) printf("Contradiction: Empty clause found\n");
+                while (i < list->size) list->clauses[j++] = list->clauses[i++];
+                list->size = j;
+                s->propagationHead = s->trailSize;
+                s->conflictClause = clause;
+                return UNSATISFIABLE;
+            }
+            if (s->verbose) printf("Easy case: Unit literal %d\n", abs(literals[0]));
+            assignLiteral(s, literals[0], clause);
+            SOLVER_STAT(s->stats.propagations++);
         }
-        itr = itr->next;
+        list->size = j;
     }
+    return UNCERTAIN;
+}
 
-//    printf("reached 2\n");
+int heapLess(struct Solver * s, int a, int b){
+    return s->activity[s->heap[a]] < s->activity[s->heap[b]];
+}
 
-    // if we reached here, that means the clause set contains no conflicting literals
-    // iterate over the clause set one last time to decide their valuation
-    itr = root;
-    while (itr != NULL){
-        struct Literal * l = itr->head;
-        while (l != NULL){
-            valuation[abs(l->index)] = l->index > 0 ? 1 : 0;
-            l = l->next;
-        }
-        itr = itr->next;
-    }
+void heapSwap(struct Solver * s, int a, int b){
+    int variable = s->heap[a];
+    s->heap[a] = s->heap[b];
+    s->heap[b] = variable;
+    s->heapPosition[s->heap[a]] = a;
+    s->heapPosition[s->heap[b]] = b;
+}
 
-    // return true to terminate dpll
-    return 1;
+void heapUp(struct Solver * s, int i){
+    while (i > 0 && heapLess(s, (i - 1) / 2, i)) {
+        heapSwap(s, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
 }
 
-// returns if the clause set contains and empty clause with no literal within
-int containsEmptyClause(struct Clause * root){
-    struct Clause* itr = root;
-    while (itr != NULL){
-        // if the head pointer is null, no literals
-        if(itr->head == NULL) return 1;
-        itr = itr->next;
+void heapDown(struct Solver * s, int i){
+    while (1) {
+        int largest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < s->heapSize && heapLess(s, largest, left)) largest = left;
+        if (right < s->heapSize && heapLess(s, largest, right)) largest = right;
+        if (largest == i) return;
+        heapSwap(s, i, largest);
+        i = largest;
     }
-    return 0;
 }
 
-// checks if the current state of the clause set represents a solution
-int checkSolution(struct Clause * root){
-    if (containsEmptyClause(root)) return UNSATISFIABLE;
-    if (areAllClausesUnit(root)) return SATISFIABLE;
-    return UNCERTAIN;
+void heapInsert(struct Solver * s, int variable){
+    if (s->heapPosition[variable] != -1) return;
+    s->heap[s->heapSize] = variable;
+    s->heapPosition[variable] = s->heapSize;
+    heapUp(s, s->heapSize++);
 }
 
-// returns a random literal index to perform branching
-int chooseLiteral(struct Clause * root){
-    // just return the first literal, it doesn't change the outcome
-    // but it maybe better to use a smarter approach for speed
-    // (e.g. choose the literal with most frequency)
-    return root->head->index;
+int heapRemoveMax(struct Solver * s){
+    int variable = s->heap[0];
+    heapSwap(s, 0, --s->heapSize);
+    s->heapPosition[variable] = -1;
+    if (s->heapSize > 0) heapDown(s, 0);
+    return variable;
+}
+
+void bumpVariable(struct Solver * s, int variable){
+    s->activity[variable] += s->activityIncrement;
+    if (s->activity[variable] > 1e100) {
+        // rescale everything to stay within double range
+        for (int i = 1; i <= s->variableNumber; i++) s->activity[i] *= 1e-100;
+        s->activityIncrement *= 1e-100;
+    }
+    if (s->heapPosition[variable] != -1) heapUp(s, s->heapPosition[variable]);
 }
 
-// deep clones a clause constructing a new clause and literal structs
-struct Clause * cloneClause(struct Clause * origin){
-    struct Clause * cloneClause = createClause();
-    struct Literal * iteratorLiteral = origin->head;
-    struct Literal * previousLiteral = NULL;
+// decays all activities at once by growing the bump increment
+void decayActivities(struct Solver * s){
+    s->activityIncrement /= VSIDS_DECAY;
+}
 
-    // iterate over the clause to clone literals as well
-    while (iteratorLiteral != NULL){
-        struct Literal * literalClone = createLiteral();
-        literalClone->index = iteratorLiteral->index;
-        if (cloneClause->head == NULL) {
-            cloneClause->head = literalClone;
+// scores every variable occurring in the clause set and queues it; the
+// Jeroslow-Wang weight 2^-|C| of each clause seeds both the static order
+// and the preferred polarity. Returns SOLVER_ERROR when memory runs out
+int initHeuristic(struct Solver * s, struct ClauseSet * set){
+    int n = s->variableNumber + 1;
+    s->heapSize = 0;
+    for (int i = 0; i < n; i++) s->heapPosition[i] = -1;
+
+    // an incremental solver carries VSIDS activities over from earlier searches
+    if (s->incremental && s->heuristic == HEURISTIC_VSIDS && s->activityIncrement > 0) {
+        for (int i = 1; i < n; i++) {
+            if (s->occurs[i] && s->assignment[i] == -1) heapInsert(s, i);
         }
-        if (previousLiteral != NULL) {
-            previousLiteral->next = literalClone;
+        return SOLVER_OK;
+    }
+    s->activityIncrement = 1.0;
+    for (int i = 0; i < n; i++) s->activity[i] = 0.0;
+    if (s->heuristic == HEURISTIC_FIRST) return SOLVER_OK;
+
+    double * positive = calloc(s->variableNumber + 1, sizeof(double));
+    double * negative = calloc(s->variableNumber + 1, sizeof(double));
+    if (positive == NULL || negative == NULL) {
+        free(positive);
+        free(negative);
+        return SOLVER_ERROR;
+    }
+    for (int c = 0; c < set->size; c = nextClause(set, c)) {
+        int size = clauseSize(set, c);
+        int * literals = clauseLiterals(set, c);
+        double weight = size < 64 ? 1.0 / (double) (1ULL << size) : 0.0;
+        for (int i = 0; i < size; i++) {
+            if (literals[i] > 0) positive[literals[i]] += weight;
+            else negative[-literals[i]] += weight;
         }
-        previousLiteral = literalClone;
-        iteratorLiteral = iteratorLiteral->next;
     }
-    return cloneClause;
+    for (int i = 1; i < n; i++) {
+        s->polarity[i] = positive[i] >= negative[i];
+        if (s->heuristic == HEURISTIC_JW) s->activity[i] = positive[i] + negative[i];
+    }
+    for (int i = 1; i < n; i++) {
+        if (s->occurs[i] && s->assignment[i] == -1) heapInsert(s, i);
+    }
+    free(positive);
+    free(negative);
+    return SOLVER_OK;
 }
 
-struct Clause * branch(struct Clause * root, int literalIndex){
-    if (verbose) printf("Hard case: Guessing %d = %s\n", abs(literalIndex), literalIndex > 0 ? "true" : "false");
-    hard_case = 1;
-
-    valuation[abs(literalIndex)] = literalIndex > 0 ? 1 : 0;
-
-    struct Clause * newClone = NULL,
-            * currentClause = NULL,
-            * previousClause = NULL,
-            * iterator = root;
-
-    // deep clone each clause one by one
-    while (iterator != NULL){
-        struct Clause * clone = cloneClause(iterator);
-        if (newClone == NULL) {
-            newClone = clone;
+// 1-UIP conflict analysis: resolves the conflicting clause with the reasons
+// of current-level literals until a single one remains. The learned clause
+// is left in learnt[0..size) with the asserting literal first and a literal
+// of the backjump level second; the backjump level is returned.
+int analyzeConflict(struct Solver * s, int * size){
+    int pathCount = 0, literal = 0, index = s->trailSize - 1, clause = s->conflictClause;
+    *size = 1;
+    do {
+        int * literals = clauseLiterals(s->clauses, clause);
+        for (int i = 0; i < clauseSize(s->clauses, clause); i++) {
+            int variable = abs(literals[i]);
+            if (literal != 0 && variable == abs(literal)) continue;
+            if (s->seen[variable] || s->level[variable] == 0) continue;
+            s->seen[variable] = 1;
+            if (s->heuristic == HEURISTIC_VSIDS) bumpVariable(s, variable);
+            if (s->level[variable] >= s->decisionLevel) pathCount++;
+            else s->learnt[(*size)++] = literals[i];
         }
-        if (previousClause != NULL) {
-            previousClause->next = clone;
+        // walk back to the most recent marked literal on the trail
+        while (!s->seen[abs(s->trail[index])]) index--;
+        literal = s->trail[index--];
+        clause = s->reason[abs(literal)];
+        s->seen[abs(literal)] = 0;
+        pathCount--;
+    } while (pathCount > 0);
+    s->learnt[0] = -literal;
+
+    int backjumpLevel = 0;
+    for (int i = 1; i < *size; i++) {
+        s->seen[abs(s->learnt[i])] = 0;
+        if (s->level[abs(s->learnt[i])] > backjumpLevel) {
+            backjumpLevel = s->level[abs(s->learnt[i])];
+            int swap = s->learnt[1];
+            s->learnt[1] = s->learnt[i];
+            s->learnt[i] = swap;
         }
-        previousClause = clone;
-        iterator = iterator->next;
     }
-
-    struct Clause * addedClause = createClause();
-    struct Literal * addedLiteral = createLiteral();
-    addedLiteral->index = literalIndex;
-    addedClause->head = addedLiteral;
-
-    addedClause->next = newClone;
-    return addedClause;
+    return backjumpLevel;
 }
 
-void removeLiteral(struct Literal * literal){
-    while (literal != NULL) {
-        struct Literal * next = literal->next;
-        free(literal);
-        literal = next;
+// appends the learned clause to the clause set and watches its first two
+// literals; returns -1 if the clause set or a watch list cannot grow
+int storeLearntClause(struct Solver * s, int size){
+    int clause = addClause(s->clauses, s->learnt, size, CLAUSE_LEARNT);
+    if (clause == -1) return -1;
+    SOLVER_STAT(s->stats.learnedClauses++);
+    if (size > 1 && (addWatch(s, s->learnt[0], clause) != SOLVER_OK || addWatch(s, s->learnt[1], clause) != SOLVER_OK)) {
+        return -1;
     }
+    return clause;
 }
 
-void removeClause(struct Clause * root){
-    while (root != NULL) {
-        struct Clause * next = root->next;
-        if (root->head != NULL) removeLiteral(root->head);
-        free(root);
-        root = next;
+// collects the failed core when assumption is found false: the assumption
+// itself and every assumption decision its negation was derived from
+void analyzeFinal(struct Solver * s, int assumption){
+    s->failed[s->failedCount++] = assumption;
+    if (s->level[abs(assumption)] == 0) return;
+    s->seen[abs(assumption)] = 1;
+    for (int i = s->trailSize - 1; i >= s->trailLimit[1]; i--) {
+        int variable = abs(s->trail[i]);
+        if (!s->seen[variable]) continue;
+        s->seen[variable] = 0;
+        if (s->reason[variable] == -1) {
+            s->failed[s->failedCount++] = s->trail[i];
+            continue;
+        }
+        int * literals = clauseLiterals(s->clauses, s->reason[variable]);
+        for (int j = 0; j < clauseSize(s->clauses, s->reason[variable]); j++) {
+            int other = abs(literals[j]);
+            if (other != variable && s->level[other] > 0) s->seen[other] = 1;
+        }
     }
 }
 
-// DPLL algorithm with recursive backtracking
-int dpll(struct Clause * root){
-
-    int solution = checkSolution(root);
-    if (solution != UNCERTAIN){
+// copies the assignment into valuation; variables that occur but were left
+// unassigned default to false, the blocking selector is no part of a model
+void storeModel(struct Solver * s){
+    for (int i = 1; i <= s->variableNumber; i++) {
+        if (s->modelLimit > 0 && i == s->blockingSelector) s->valuation[i] = -1;
+        else if (!s->occurs[i] && s->assignment[i] == -1) s->valuation[i] = -1;
+        else s->valuation[i] = s->assignment[i] == 1;
+    }
+}
 
-        return solution;
+// returns an unassigned projected variable, as the false literal it defaults
+// to, or 0; a model only counts once they are all set. Projected variables
+// that occur in no clause are free and get both values this way
+int unassignedProjected(struct Solver * s){
+    for (int i = 0; i < s->projectionCount; i++) {
+        int variable = s->projection[i];
+        if (s->assignment[variable] == -1) return -variable;
     }
+    return 0;
+}
 
-    while(1){
-        solution = checkSolution(root);
-        if (solution != UNCERTAIN){
+// Adds the clause excluding the projection of the current model, conditioned
+// on the blocking selector, and backtracks to the deepest level among its
+// literals, where it becomes the conflict clause. Returns UNSATISFIABLE when
+// no other projection exists, SOLVER_ERROR when memory runs out, else
+// UNCERTAIN.
+int blockModel(struct Solver * s){
+    int size = 0, deepest = 0;
+    s->learnt[size++] = -s->blockingSelector;
+    for (int i = 0; i < s->projectionCount; i++) {
+        int variable = s->projection[i];
+        if (s->assignment[variable] == -1 || s->level[variable] == 0) continue;
+        s->learnt[size++] = s->assignment[variable] ? -variable : variable;
+        if (s->level[variable] > deepest) deepest = s->level[variable];
+    }
+    if (deepest == 0) return UNSATISFIABLE;
 
-            return solution;
+    // watch the two deepest literals
+    for (int front = 0; front < 2; front++) {
+        int best = front;
+        for (int i = front + 1; i < size; i++) {
+            if (s->level[abs(s->learnt[i])] > s->level[abs(s->learnt[best])]) best = i;
         }
-        if (!unitPropagation(&root)) break;
+        int swap = s->learnt[front];
+        s->learnt[front] = s->learnt[best];
+        s->learnt[best] = swap;
     }
 
-    while(1){
-        int solution = checkSolution(root);
-        if (solution != UNCERTAIN) {
+    backtrack(s, deepest);
+    int clause = addClause(s->clauses, s->learnt, size, 0);
+    if (clause == -1) return SOLVER_ERROR;
+    if (addWatch(s, s->learnt[0], clause) != SOLVER_OK || addWatch(s, s->learnt[1], clause) != SOLVER_OK) {
+        return SOLVER_ERROR;
+    }
+    s->conflictClause = clause;
+    return UNCERTAIN;
+}
 
-            return solution;
+// returns the first unassigned literal of the first unsatisfied clause,
+// or 0 when every clause is satisfied
+int firstOpenLiteral(struct Solver * s){
+    // just return the first open literal, it doesn't change the outcome
+    // but it maybe better to use a smarter approach for speed
+    // (e.g. choose the literal with most frequency)
+    struct ClauseSet * set = s->clauses;
+    for (int c = 0; c < set->size; c = nextClause(set, c)){
+        int candidate = 0;
+        int * literals = clauseLiterals(set, c);
+        for (int i = 0; i < clauseSize(set, c); i++){
+            int value = literalValue(s, literals[i]);
+            if (value == 1) {
+                candidate = 0;
+                break;
+            }
+            if (value == -1 && candidate == 0) candidate = literals[i];
         }
-        if (!pureLiteralElimination(root)) break;
+        if (candidate != 0) return candidate;
     }
-
-    int literalIndex = chooseLiteral(root);
-
-    if (dpll(branch(root, literalIndex)) == SATISFIABLE) return SATISFIABLE;
-
-    if (verbose) printf("Contradiction: Backtracking and trying literal %d = %s\n", abs(literalIndex),literalIndex > 0 ? "false" : "true");
-    return dpll(branch(root, -literalIndex));
+    return 0;
 }
 
-struct Clause * readClauseSetFromInput(char cnf[][100], int numClauses, int bnf) {
-    struct Clause *root = NULL, *currentClause = NULL, *previousClause = NULL;
-    struct Literal *currentLiteral = NULL, *previousLiteral = NULL;
+// returns the literal to branch on, or 0 when the assignment is complete
+int chooseLiteral(struct Solver * s){
+    if (s->heuristic == HEURISTIC_FIRST) return firstOpenLiteral(s);
 
-    if(bnf == 1){
-        variableNumber = 26;
-    }else{
-        variableNumber = 729;
-    };
+    // pop the most active variable that is still unassigned
+    while (s->heapSize > 0) {
+        int variable = heapRemoveMax(s);
+        if (s->assignment[variable] == -1) return s->polarity[variable] ? variable : -variable;
+    }
+    return 0;
+}
 
-    if (valuation == NULL) {
-        valuation = (int*) calloc(variableNumber + 1, sizeof(int));
-        for (int i = 0; i <= variableNumber; i++) {
-            valuation[i] = -1;
-        }
+// returns element index (from 0) of the Luby sequence 1 1 2 1 1 2 4 1 1 2 ...
+long long luby(int index){
+    int size = 1, exponent = 0;
+    while (size < index + 1) {
+        exponent++;
+        size = 2 * size + 1;
     }
+    while (size - 1 != index) {
+        size = (size - 1) / 2;
+        exponent--;
+        index %= size;
+    }
+    return 1LL << exponent;
+}
 
-    for (int i = 0; i < numClauses; i++) {
-        currentClause = createClause();
-        if (root == NULL) {
-            root = currentClause;
-        }
-        if (previousClause != NULL) {
-            previousClause->next = currentClause;
+// DPLL algorithm with trail-based chronological backtracking, or
+// conflict-driven clause learning with backjumping when cdcl is set.
+// Learned clauses are appended to the given clause set. The assumptions
+// in s are decided first, so UNSATISFIABLE means unsatisfiable under them.
+// Returns SATISFIABLE, UNSATISFIABLE or SOLVER_ERROR when memory runs out.
+int dpll(struct Solver * s, struct ClauseSet * set){
+    s->failedCount = 0;
+    int solution;
+    if (s->incremental && set == s->clauses && s->attachedSize >= 0) {
+        // the watches and level 0 assignments of the previous search still
+        // hold, only the clauses added since then need attaching
+        backtrack(s, 0);
+        solution = s->inconsistent ? UNSATISFIABLE : attachClauses(s, s->attachedSize);
+    } else {
+        for (int i = 0; i <= s->variableNumber; i++) s->assignment[i] = -1;
+        s->trailSize = 0;
+        s->propagationHead = 0;
+        s->decisionLevel = 0;
+        s->clauses = set;
+        for (int i = 0; i < 2 * (s->variableNumber + 1); i++) s->watches[i].size = 0;
+        memset(s->occurs, 0, s->variableNumber + 1);
+        solution = attachClauses(s, 0);
+    }
+    s->inconsistent = solution == UNSATISFIABLE;
+
+    int blocked = 0;  // a blocking clause stands in for the next conflict
+    int restarts = 0;
+    long long conflictsSinceRestart = 0;
+    if (initHeuristic(s, set) != SOLVER_OK) solution = SOLVER_ERROR;
+    while (solution == UNCERTAIN) {
+        int propagated = blocked ? UNSATISFIABLE : unitPropagation(s);
+        if (propagated == SOLVER_ERROR) {
+            solution = SOLVER_ERROR;
+            break;
         }
-
-        char *token = strtok(cnf[i], " ");
-        while (token != NULL) {
-            int isNegated = 0;
-
-            // Check for negation (!)
-            if (token[0] == '!') {
-                isNegated = 1;
-                token++;  // Skip the '!' character
+        if (propagated == UNSATISFIABLE) {
+            blocked = 0;
+            SOLVER_STAT(s->stats.conflicts++);
+            if (s->heuristic == HEURISTIC_VSIDS) {
+                // chronological search has no analysis, bump the falsified clause
+                if (!s->cdcl) {
+                    int * literals = clauseLiterals(s->clauses, s->conflictClause);
+                    for (int i = 0; i < clauseSize(s->clauses, s->conflictClause); i++) {
+                        bumpVariable(s, abs(literals[i]));
+                    }
+                }
+                decayActivities(s);
             }
-
-            int literalIndex = 0;
-
-            if (bnf == 1) {
-                // Handling ABCD tokens
-                if (strlen(token) != 1 || token[0] < 'A' || token[0] > 'Z') {
-                    fprintf(stderr, "Error: Invalid token format '%s'\n", token);
-                    exit(EXIT_FAILURE);
+            if (s->cdcl) {
+                if (s->decisionLevel == 0) {
+                    s->inconsistent = 1;
+                    solution = UNSATISFIABLE;
+                    break;
                 }
-                literalIndex = token[0] - 'A' + 1;
-            } else {
-                // Extract val, row, col from the token (for n{val}_r{row}_c{col} format)
-                int val, row, col;
-                if (sscanf(token, "n%d_r%d_c%d", &val, &row, &col) != 3) {
-                    fprintf(stderr, "Error: Invalid token format '%s'\n", token);
-                    exit(EXIT_FAILURE);
+                int size;
+                int backjumpLevel = analyzeConflict(s, &size);
+                if (s->verbose) printf("Contradiction: Learned clause of %d literals, backjumping to level %d\n", size, backjumpLevel);
+
+                // restarts keep the learned clauses and saved phases but
+                // let the activities pick a new set of early decisions
+                int restart = s->restartInterval > 0 && ++conflictsSinceRestart >= s->restartInterval * luby(restarts);
+                if (restart) {
+                    if (s->verbose) printf("Restart %d after %lld conflicts\n", restarts + 1, conflictsSinceRestart);
+                    restarts++;
+                    conflictsSinceRestart = 0;
                 }
+                backtrack(s, restart ? 0 : backjumpLevel);
+                int clause = storeLearntClause(s, size);
+                if (clause == -1) {
+                    solution = SOLVER_ERROR;
+                    break;
+                }
+                if (s->decisionLevel == backjumpLevel) assignLiteral(s, s->learnt[0], clause);
+                continue;
+            }
 
-                // Calculate the literal index based on val, row, col
-                literalIndex = (val - 1) + (row - 1) * 9 + (col - 1) * 81 + 1;
+            // drop levels whose both branches failed; assumption levels count as failed
+            int conflictLevel = s->decisionLevel;
+            while (s->decisionLevel > 0 && s->flipped[s->decisionLevel]) backtrack(s, s->decisionLevel - 1);
+            if (s->decisionLevel == 0) {
+                // without learning no smaller core is known than every assumption
+                if (conflictLevel > 0) {
+                    for (int i = 0; i < s->assumptionCount; i++) s->failed[s->failedCount++] = s->assumptions[i];
+                } else {
+                    s->inconsistent = 1;
+                }
+                solution = UNSATISFIABLE;
+                break;
             }
+            int literalIndex = s->trail[s->trailLimit[s->decisionLevel]];
+            backtrack(s, s->decisionLevel - 1);
+            if (s->verbose) printf("Contradiction: Backtracking and trying literal %d = %s\n", abs(literalIndex), literalIndex > 0 ? "false" : "true");
+            decide(s, -literalIndex, 1);
+            continue;
+        }
 
-            // Apply negation if necessary
-            if (isNegated) {
-                literalIndex = -literalIndex;
+        // level i + 1 holds assumption i; one that already holds gets an empty level
+        if (s->decisionLevel < s->assumptionCount) {
+            int assumption = s->assumptions[s->decisionLevel];
+            int value = literalValue(s, assumption);
+            if (value == 0) {
+                analyzeFinal(s, assumption);
+                solution = UNSATISFIABLE;
+                break;
             }
+            if (value == 1) {
+                s->decisionLevel++;
+                s->trailLimit[s->decisionLevel] = s->trailSize;
+                s->flipped[s->decisionLevel] = 1;
+            } else {
+                decide(s, assumption, 1);  // never flipped by chronological backtracking
+            }
+            continue;
+        }
 
-            // Create and add the literal to the clause
-            currentLiteral = createLiteral();
-            currentLiteral->index = literalIndex;
+        int literalIndex = chooseLiteral(s);
+        if (literalIndex == 0 && s->modelLimit > 0) literalIndex = unassignedProjected(s);
+        if (literalIndex == 0 && s->modelLimit > 0) {
+            // report the model, then exclude it and keep searching
+            storeModel(s);
+            s->modelCount++;
+            if (s->onModel) s->onModel(s, s->modelData);
+            int status = s->modelCount < s->modelLimit ? blockModel(s) : UNSATISFIABLE;
+            if (status != UNCERTAIN) {
+                solution = status == SOLVER_ERROR ? SOLVER_ERROR : SATISFIABLE;
+                break;
+            }
+            blocked = 1;
+            continue;
+        }
+        if (literalIndex == 0) {
+            solution = SATISFIABLE;
+            break;
+        }
+        if (s->verbose) printf("Hard case: Guessing %d = %s\n", abs(literalIndex), literalIndex > 0 ? "true" : "false");
+        decide(s, literalIndex, 0);
+    }
 
-            valuation[abs(literalIndex)] = 0;
+    // every clause is attached now, learned and blocking clauses included;
+    // after an error the next search starts over
+    s->attachedSize = solution == SOLVER_ERROR ? -1 : set->size;
 
-            if (currentClause->head == NULL) {
-                currentClause->head = currentLiteral;
-            } else if (previousLiteral != NULL) {
-                previousLiteral->next = currentLiteral;
-            }
+    // an enumeration keeps the last model it reported
+    if (s->modelLimit == 0) storeModel(s);
+    else if (solution == UNSATISFIABLE && s->modelCount > 0) solution = SATISFIABLE;
+    return solution;
+}
 
-            previousLiteral = currentLiteral;
-            token = strtok(NULL, " ");
-        }
+// Public solver API: a solver_t owns its clause set, grows its variable
+// range on demand and reports errors through return codes.
 
-        previousClause = currentClause;
+solver_t * solver_create(void) {
+    struct Solver * solver = createSolver(0);
+    if (solver == NULL) return NULL;
+    solver->clauses = createClauseSet();
+    if (solver->clauses == NULL) {
+        freeSolver(solver);
+        return NULL;
     }
+    solver->incremental = 1;
+    return solver;
+}
 
-    return root;
+int solver_add_clause(solver_t * solver, const int * literals, int size) {
+    if (size < 0 || (size > 0 && literals == NULL)) return SOLVER_ERROR;
+    int highest = 0;
+    for (int i = 0; i < size; i++) {
+        if (literals[i] == 0 || literals[i] == INT_MIN) return SOLVER_ERROR;
+        if (abs(literals[i]) > highest) highest = abs(literals[i]);
+    }
+    if (reserveVariables(solver, highest) != SOLVER_OK) return SOLVER_ERROR;
+    if (addClause(solver->clauses, literals, size, 0) == -1) return SOLVER_ERROR;
+    return SOLVER_OK;
 }
 
-void writeSolutionToOutput(struct Clause * root, int * valuation, int bnf) {
-    if (bnf == 1) {
-        printf("Solution:\n");
+int solver_solve(solver_t * solver) {
+    return solver_solve_assumptions(solver, NULL, 0);
+}
 
-        for (int i = 1; i <= variableNumber; i++) {
-            if (valuation[i] != -1) {
-                // Convert the index (1-26) to a letter (A-Z)
-                char letter = 'A' + (i - 1);
+int solver_solve_assumptions(solver_t * solver, const int * assumptions, int count) {
+    if (count < 0 || (count > 0 && assumptions == NULL)) return SOLVER_ERROR;
+    int highest = 0;
+    for (int i = 0; i < count; i++) {
+        if (assumptions[i] == 0 || assumptions[i] == INT_MIN) return SOLVER_ERROR;
+        if (abs(assumptions[i]) > highest) highest = abs(assumptions[i]);
+    }
+    if (reserveVariables(solver, highest) != SOLVER_OK) return SOLVER_ERROR;
+    int * kept = malloc((count + 1) * sizeof(int));
+    int * failed = realloc(solver->failed, (count + 1) * sizeof(int));
+    if (failed != NULL) solver->failed = failed;
+    if (kept == NULL || failed == NULL) {
+        free(kept);
+        return SOLVER_ERROR;
+    }
 
-                // Output the letter and its assignment (True/False)
-                printf("%c = %s\n", letter, valuation[i] == 1 ? "True" : "False");
-            }
-        }
-    }else{
-        printf("Solution:\n");
-        int sudoku_board[9][9] = {0};  // Initialize an empty Sudoku board
-
-        for (int i = 1; i <= variableNumber; i++) {
-            if (valuation[i] != -1) { // If the variable has been assigned
-                // Reverse the index to val, row, col
-                int val = (i - 1) % 9 + 1;
-                int row = ((i - 1) / 9) % 9 + 1;
-                int col = (i - 1) / 81 + 1;
-
-                // Print the solution for each variable
-                if(verbose){
-                    printf("n%d_r%d_c%d = %s\n", val, row, col, valuation[i] == 1 ? "True" : "False");
-                }
+    // drop repeated assumptions, so every decision level holds a distinct
+    // variable; seen marks the polarities taken and is cleared again
+    int size = 0;
+    for (int i = 0; i < count; i++) {
+        char polarity = assumptions[i] > 0 ? 1 : 2;
+        if (solver->seen[abs(assumptions[i])] & polarity) continue;
+        solver->seen[abs(assumptions[i])] |= polarity;
+        kept[size++] = assumptions[i];
+    }
+    for (int i = 0; i < size; i++) solver->seen[abs(kept[i])] = 0;
+
+    solver->assumptions = kept;
+    solver->assumptionCount = size;
+    int result = dpll(solver, solver->clauses);
+    solver->assumptions = NULL;
+    solver->assumptionCount = 0;
+    free(kept);
+    return result;
+}
 
-                // Fill the Sudoku board if the variable is true
-                if (valuation[i] == 1) {
-                    sudoku_board[row - 1][col - 1] = val;
-                }
-            }
-        }
+int solver_failed(const solver_t * solver, int literal) {
+    for (int i = 0; i < solver->failedCount; i++) {
+        if (solver->failed[i] == literal) return 1;
+    }
+    return 0;
+}
 
-        // Now print the filled Sudoku board
-        for (int i = 0; i < 9; i++) {
-            for (int j = 0; j < 9; j++) {
-                printf("%d ", sudoku_board[i][j]);
-            }
-            printf("\n");
+int solver_get_model(const solver_t * solver, int variable) {
+    if (variable < 1 || variable > solver->variableNumber) return -1;
+    return solver->valuation[variable];
+}
+
+void solver_destroy(solver_t * solver) {
+    if (solver == NULL) return;
+    freeClauseSet(solver->clauses);
+    freeSolver(solver);
+}
+
+int solver_enumerate(solver_t * solver, const int * projection, int count, int limit,
+                     void (* onModel)(const solver_t * solver, void * data), void * data) {
+    if (limit < 1 || count < 0 || (count > 0 && projection == NULL)) return SOLVER_ERROR;
+    int highest = solver->variableNumber;
+    for (int i = 0; i < count; i++) {
+        if (projection[i] == 0 || projection[i] == INT_MIN) return SOLVER_ERROR;
+        if (abs(projection[i]) > highest) highest = abs(projection[i]);
+    }
+    if (reserveVariables(solver, highest) != SOLVER_OK) return SOLVER_ERROR;
+    int * variables = realloc(solver->projection, ((count > 0 ? count : highest) + 1) * sizeof(int));
+    if (variables == NULL) return SOLVER_ERROR;
+    solver->projection = variables;
+
+    int size = 0;
+    if (count == 0) {
+        for (int i = 1; i <= highest; i++) variables[size++] = i;
+    } else {
+        for (int i = 0; i < count; i++) {
+            if (solver->seen[abs(projection[i])]) continue;
+            solver->seen[abs(projection[i])] = 1;
+            variables[size++] = abs(projection[i]);
         }
+        for (int i = 0; i < size; i++) solver->seen[variables[i]] = 0;
+    }
+
+    // a fresh selector conditions the blocking clauses. A clause learned from
+    // them either mentions it or holds in every model with the selector
+    // false, which covers all original models; removing the clauses of the
+    // selector afterwards thus restores the original formula, and the
+    // variable is handed back so every enumeration reuses the same number
+    int selector = highest + 1;
+    if (reserveVariables(solver, selector) != SOLVER_OK) return SOLVER_ERROR;
+    solver->projectionCount = size;
+    solver->modelLimit = limit;
+    solver->modelCount = 0;
+    solver->blockingSelector = selector;
+    solver->onModel = onModel;
+    solver->modelData = data;
+    int result = solver_solve_assumptions(solver, &selector, 1);
+    solver->modelLimit = 0;
+    solver->onModel = NULL;
+
+    removeClausesWith(solver->clauses, selector);
+    solver->attachedSize = -1;  // the remaining clauses moved
+    for (int i = watchIndex(selector); i <= watchIndex(-selector); i++) {
+        free(solver->watches[i].clauses);
+        solver->watches[i] = (struct WatchList) {0};
     }
-}
\ No newline at end of file
+    solver->variableNumber = selector - 1;  // reserving it again zeroes its state
+    return result == SOLVER_ERROR ? SOLVER_ERROR : solver->modelCount;
+}
@@ -5,24 +5,179 @@
 #ifndef SUDOKU_DPLL_SOLVER_H
 #define SUDOKU_DPLL_SOLVER_H
 
-// Define the Clause and Literal structures
-struct Literal {
-    struct Literal * next;
-    int index;
+// Clause database: clauses are stored back to back in one contiguous int
+// arena as a header (size, flags) followed by their literals, and are
+// referenced by their offset into the arena
+#define CLAUSE_HEADER 2
+#define CLAUSE_LEARNT 1  // flag of clauses added by conflict analysis
+
+struct ClauseSet {
+    int * arena;
+    int size;      // ints in use
+    int capacity;  // ints allocated
+    int count;     // number of clauses
+};
+
+#define clauseSize(set, offset) ((set)->arena[(offset)])
+#define clauseFlags(set, offset) ((set)->arena[(offset) + 1])
+#define clauseLiterals(set, offset) ((set)->arena + (offset) + CLAUSE_HEADER)
+#define nextClause(set, offset) ((offset) + CLAUSE_HEADER + clauseSize(set, offset))
+
+// Solver results and API status codes
+#define SATISFIABLE 1
+#define UNSATISFIABLE (-1)
+#define SOLVER_OK 0
+#define SOLVER_ERROR (-2)  // invalid input or out of memory
+
+// Decision heuristics selectable for chooseLiteral()
+#define HEURISTIC_FIRST 0  // first open literal of the first unsatisfied clause
+#define HEURISTIC_VSIDS 1  // conflict-driven activity with a binary heap
+#define HEURISTIC_JW 2     // static Jeroslow-Wang clause-length weights
+
+#define RESTART_INTERVAL 100  // default conflicts per Luby restart unit
+
+// Two-watched-literal scheme: every clause with two or more literals keeps
+// its watched literals in its first two slots and is listed in the watch
+// list of both. A clause only needs a visit when a watched literal becomes
+// false.
+struct WatchList {
+    int * clauses;  // clause offsets
+    int size;
+    int capacity;
+};
+
+#define VSIDS_DECAY 0.95
+
+// Search counters, accumulated over every search of a solver. Updating them
+// costs a few increments on the hot paths; building with DPLL_STATS=0
+// compiles the updates out and leaves the counters at zero.
+#ifndef DPLL_STATS
+#define DPLL_STATS 1
+#endif
+#if DPLL_STATS
+#define SOLVER_STAT(statement) do { statement; } while (0)
+#else
+#define SOLVER_STAT(statement) do { } while (0)
+#endif
+
+struct SolverStats {
+    long long decisions;       // branching literals, flipped chronological branches included
+    long long propagations;    // literals implied by unit propagation
+    long long conflicts;
+    long long backtracks;      // decision levels undone
+    long long learnedClauses;
+    int maxDepth;              // deepest decision level reached
 };
 
-struct Clause {
-    struct Literal * head;
-    struct Clause * next;
+// Solver context: options, the model of the last search and the search
+// workspace. A solver only ever touches its own state, so independent
+// solvers can run on different threads.
+struct Solver {
+    int verbose;         // print every propagation, guess and backtrack
+    int cdcl;            // conflict-driven clause learning with backjumping instead of chronological backtracking
+    int heuristic;       // decision heuristic used by chooseLiteral()
+    int restartInterval; // conflicts per unit of the Luby restart schedule under cdcl, 0 never restarts
+    int variableNumber;
+    int * valuation;     // model of the last search: -1 for unassigned variables not in the clause set, else 0/1
+
+    // Assignment trail shared by every decision level. Backtracking only
+    // unassigns trail entries, so the clause set itself is never copied.
+    struct ClauseSet * clauses;  // clause database of the running search, learned clauses are appended to it
+    int * assignment;    // per variable: -1 unassigned, 0 false, 1 true
+    int * trail;         // assigned literals in assignment order
+    int trailSize;
+    int * trailLimit;    // trail position of the decision opening each level
+    int * flipped;       // whether the decision at a level is already its second branch
+    int decisionLevel;
+    int propagationHead; // next trail entry whose consequences are unprocessed
+    int * level;         // decision level at which each variable was assigned
+    int * reason;        // offset of the clause that implied each variable, -1 for decisions and units
+    int conflictClause;  // offset of the clause falsified by the last failed propagation
+    char * seen;         // conflict analysis marks
+    char * occurs;       // whether a variable appears in the clause set
+    int * learnt;        // literals of the clause being learned
+    struct WatchList * watches;  // indexed by 2 * variable + (literal < 0)
+
+    // Decision order for the VSIDS and Jeroslow-Wang heuristics: a binary
+    // max-heap of unassigned variables keyed by activity. VSIDS bumps the
+    // activity of variables involved in conflicts, Jeroslow-Wang keeps the
+    // static scores computed from the input clauses.
+    double * activity;
+    double activityIncrement;
+    int * heap;
+    int heapSize;
+    int * heapPosition;  // index in heap, -1 when not queued
+    char * polarity;     // preferred value when branching on a variable
+    int incremental;     // keep VSIDS activities and phases, watches and level 0 assignments from one search to the next
+    int attachedSize;    // incremental only: arena prefix whose watches are attached, -1 forces attaching all clauses again
+    int inconsistent;    // incremental only: the attached clauses are unsatisfiable without any assumption
+
+    // Assumptions of the running search, decided in order on the first
+    // decision levels. When the search fails under them, failed holds the
+    // assumptions that cannot hold together.
+    const int * assumptions;
+    int assumptionCount;
+    int * failed;
+    int failedCount;
+
+    // Model enumeration: with modelLimit set, every model is reported to
+    // onModel, excluded by a clause over the projected variables and the
+    // search continues from there until the limit or no model is left
+    int modelLimit;      // 0 for an ordinary search
+    int modelCount;
+    int * projection;    // variables whose values distinguish models
+    int projectionCount;
+    int blockingSelector;  // assumed variable that every blocking clause is conditioned on
+    void (* onModel)(const struct Solver * solver, void * data);
+    void * modelData;
+
+    struct SolverStats stats;
 };
 
-extern int *valuation;
-extern int verbose;
+// Declare clause set functions
+struct ClauseSet * createClauseSet();
+int addClause(struct ClauseSet * set, const int * literals, int size, int flags);
+struct ClauseSet * copyClauseSet(const struct ClauseSet * set);
+void truncateClauseSet(struct ClauseSet * set, int size, int count);
+void removeClausesWith(struct ClauseSet * set, int variable);
+void freeClauseSet(struct ClauseSet * set);
 
 // Declare DPLL functions
-int dpll(struct Clause * root);
-struct Clause * readClauseSetFromInput(char cnf[][100], int numClauses, int bnf);
-void removeClause(struct Clause * root);
-void writeSolutionToOutput(struct Clause * root, int * valuation, int bnf);
+struct Solver * createSolver(int numVariables);
+int reserveVariables(struct Solver * solver, int numVariables);
+void freeSolver(struct Solver * solver);
+int dpll(struct Solver * solver, struct ClauseSet * set);
+
+// Reentrant solver API. Every call works on its own solver_t only and
+// reports failures through its return value; the library never exits the
+// process and only prints the search trace when verbose is set. Options
+// (verbose, cdcl, heuristic) are plain fields of the context, and so are
+// the search counters in stats. Solving is incremental: clauses and learned
+// clauses persist across calls, and every call may add assumptions that
+// only hold for that call. The watches and the assignments implied at level
+// 0 persist as well, so a call only attaches the clauses added since the
+// previous one. Learned clauses are never deleted, the clause set grows
+// with every conflict of every call.
+typedef struct Solver solver_t;
+
+solver_t * solver_create(void);  // NULL when out of memory
+int solver_add_clause(solver_t * solver, const int * literals, int size);  // SOLVER_OK or SOLVER_ERROR
+int solver_solve(solver_t * solver);  // SATISFIABLE, UNSATISFIABLE or SOLVER_ERROR
+int solver_solve_assumptions(solver_t * solver, const int * assumptions, int count);  // as solver_solve()
+// 1 when the assumption belongs to the failed core of the last search that
+// ended UNSATISFIABLE, else 0. An empty core means the clauses alone are
+// unsatisfiable; without cdcl every assumption is blamed unless one is
+// refuted directly.
+int solver_failed(const solver_t * solver, int literal);
+// Finds up to limit models that differ on the projected variables (all
+// variables when count is 0), calling onModel, which may be NULL, with the
+// model in valuation. Returns the number of models or SOLVER_ERROR; a
+// result below limit means every model was found, so limit 2 is a
+// uniqueness check. Projected variables that occur in no clause are free
+// and take both values. The clauses excluding the models are removed again before it returns.
+int solver_enumerate(solver_t * solver, const int * projection, int count, int limit,
+                     void (* onModel)(const solver_t * solver, void * data), void * data);
+int solver_get_model(const solver_t * solver, int variable);  // 1, 0 or -1 when unassigned
+void solver_destroy(solver_t * solver);
 
 #endif //SUDOKU_DPLL_SOLVER_H
@@ -2,28 +2,111 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/resource.h>
 #include "cnf_library.h"
 #include "dpll_solver.h"
+#include "dimacs.h"
+#include "preprocess.h"
+
+// At-most-one encodings of the row, column and block rules
+#define AMO_PAIRWISE 0    // one binary clause per pair of variables
+#define AMO_SEQUENTIAL 1  // sequential counter with one auxiliary per variable
+#define AMO_COMMANDER 2   // commander variables over groups of three, applied recursively
+#define AMO_PRODUCT 3     // variables on a grid imply their row and column, applied recursively
+#define AMO_PAIRWISE_LIMIT 4  // groups up to this size are always encoded pairwise
+const char *amo_encoding_names[] = {"pairwise", "sequential", "commander", "product"};
 
-#define SIZE 9
-#define SATISFIABLE 1
-#define UNSATISFIABLE (-1)
 
 int verbose = 0;  // Verbose mode flag
+int cdcl = 0;  // Solve with clause learning and backjumping
+int tseitin = 0;  // Convert BNF to CNF with auxiliary variables instead of distribution
+int preprocessing = 0;  // Simplify the clauses before search
+int heuristic = HEURISTIC_FIRST;  // Decision heuristic passed to every solver
+int amo_encoding = AMO_PAIRWISE;  // At-most-one encoding of the sudoku rules, one of AMO_*
+int compact = 0;  // Leave variables fixed by the clues out of the sudoku encoding
+int compare_encodings = 0;  // Report size and solve time of every sudoku encoding
+int num_threads = 1;  // Worker threads in batch mode
+int max_models = 0;  // Print up to this many solutions instead of one (-enumerate)
+int unique_check = 0;  // Only tell whether the solution is unique (-unique)
 char *bnf_file = NULL;  // BNF file name (optional)
-int sudoku_board[SIZE][SIZE] = {0};  // Sudoku board initialized to 0 (unset)
+char *batch_file = NULL;  // Puzzle file solved in batch mode (optional)
+char *query_file = NULL;  // Assumption queries answered against the given board (optional)
+char *dimacs_file = NULL;  // DIMACS CNF file solved directly (optional)
+char *dump_file = NULL;  // Where to write the generated CNF as DIMACS (optional)
+int box_size = 3;  // Side of one block, the grid is box_size^2 x box_size^2
+int sudoku_size = 9;  // Side of the grid
+int *sudoku_board = NULL;  // Row-major sudoku_size x sudoku_size board, 0 is unset
 int bnf = -1;  // Extra credit flag
+char *stats_file = NULL;  // Where to write the run statistics at exit, "-" for standard output (optional)
+int stats_csv = 0;  // Write the statistics as CSV instead of JSON
+
+// Phases of a run timed for the statistics
+#define PHASE_GENERATE 0  // sudoku clause generation
+#define PHASE_PARSE 1     // reading BNF formulas, DIMACS clauses or puzzles
+#define PHASE_CONVERT 2   // BNF to CNF conversion
+#define PHASE_DEDUP 3     // canonicalizing and deduplicating clauses
+#define PHASE_SOLVE 4     // preprocessing and search
+#define PHASES 5
+const char *phase_names[] = {"generate", "parse", "convert", "dedup", "solve"};
+double phase_seconds[PHASES];  // wall time spent in each phase
+struct SolverStats run_stats;  // counters summed over every solver of the run
+const char *run_result = "UNKNOWN";  // outcome of the last search
+
+// Sudoku clause generation state
+struct SudokuEncoder {
+    struct ClauseSet *set;
+    int amo;             // AMO_* encoding
+    const int *board;    // clues the encoding is simplified with, NULL to encode every variable
+    char *open;          // per cell variable: whether it is part of the encoding
+    int variables;       // cell variables followed by the auxiliaries allocated so far
+};
 
 void parse_arguments(int argc, char *argv[]);
 void parse_sudoku_inputs(int argc, char *argv[], int start_index);
 void print_sudoku_board();
-int generate_bnf_clauses(char bnfClauses[10000][100]);
+void print_board_row(const int *row);
+void generate_bnf_clauses(struct CNFOutput *out);
 void generate_cnf_clauses();
-void generate_at_least_one_digit_clauses(char cnf[][100], int *index);
-void generate_unique_row_clauses(char cnf[][100], int *index);
-void generate_unique_column_clauses(char cnf[][100], int *index);
-void generate_unique_block_clauses(char cnf[][100], int *index);
+void compare_sudoku_encodings();
+void init_sudoku_encoder(struct SudokuEncoder *encoder, int amo, const int *board);
+void free_sudoku_encoder(struct SudokuEncoder *encoder);
+void generate_clue_clauses(struct SudokuEncoder *encoder, const int *board);
+int sudoku_variable(int val, int row, int col);
+void print_sudoku_clause_set(struct ClauseSet *set);
+void generate_at_least_one_digit_clauses(struct SudokuEncoder *encoder);
+void generate_unique_row_clauses(struct SudokuEncoder *encoder);
+void generate_unique_column_clauses(struct SudokuEncoder *encoder);
+void generate_unique_block_clauses(struct SudokuEncoder *encoder);
+void generate_sudoku_constraints(struct SudokuEncoder *encoder);
+void add_binary_clause(struct SudokuEncoder *encoder, int literal1, int literal2);
+void add_at_most_one(struct SudokuEncoder *encoder, const int *variables, int count);
 void parse_bnf_file(const char *filename);
+void convert_bnf_line(struct CNFOutput *out, const char *source, int line_number, const char *line);
+void report_syntax_error(const char *source, int line_number, const char *line, const struct SyntaxError *error);
+struct Solver *create_configured_solver(int variables);
+int solve_clause_set(struct Solver *solver, struct ClauseSet *set);
+int parse_puzzle_line(const char *line, int *board);
+void solve_batch_file(const char *filename);
+void format_solution_line(const struct Solver *solver, char *line);
+int parse_cell_assignment(const char *text, int *row, int *col, int *val);
+void solve_query_file(const char *filename);
+void solve_dimacs_file(const char *filename);
+solver_t *create_incremental_solver(const struct ClauseSet *set);
+int *sudoku_projection(const char *open, int *count);
+int enumerate_solutions(const struct ClauseSet *set, const int *projection, int count,
+                        void (*print_model)(const solver_t *solver, void *data), void *data);
+void print_sudoku_model(const solver_t *solver, void *data);
+void print_bnf_model(const solver_t *solver, void *data);
+void dump_dimacs(const struct ClauseSet *set, int variables);
+void phase_start(struct timespec *start);
+void phase_end(int phase, const struct timespec *start);
+void add_solver_stats(struct SolverStats *total, const struct SolverStats *stats);
+void record_solver_stats(const struct Solver *solver, int result);
+void write_stats();
 
 void parse_arguments(int argc, char *argv[]) {
     int i = 1;
@@ -31,6 +114,86 @@ void parse_arguments(int argc, char *argv[]) {
         if (strcmp(argv[i], "-v") == 0) {
             verbose = 1;
             i++;
+        } else if (strcmp(argv[i], "-cdcl") == 0) {
+            cdcl = 1;
+            i++;
+        } else if (strcmp(argv[i], "-tseitin") == 0) {
+            tseitin = 1;
+            i++;
+        } else if (strcmp(argv[i], "-preprocess") == 0) {
+            preprocessing = 1;
+            i++;
+        } else if (strcmp(argv[i], "-heuristic") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "first") == 0) heuristic = HEURISTIC_FIRST;
+            else if (strcmp(argv[i + 1], "vsids") == 0) heuristic = HEURISTIC_VSIDS;
+            else if (strcmp(argv[i + 1], "jw") == 0) heuristic = HEURISTIC_JW;
+            else {
+                fprintf(stderr, "Error: Unknown heuristic '%s'\n", argv[i + 1]);
+                exit(EXIT_FAILURE);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "-amo") == 0 && i + 1 < argc) {
+            amo_encoding = -1;
+            for (int amo = AMO_PAIRWISE; amo <= AMO_PRODUCT; amo++) {
+                if (strcmp(argv[i + 1], amo_encoding_names[amo]) == 0) amo_encoding = amo;
+            }
+            if (amo_encoding == -1) {
+                fprintf(stderr, "Error: Unknown at-most-one encoding '%s'\n", argv[i + 1]);
+                exit(EXIT_FAILURE);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "-compact") == 0) {
+            compact = 1;
+            i++;
+        } else if (strcmp(argv[i], "-compare-encodings") == 0) {
+            compare_encodings = 1;
+            i++;
+        } else if (strcmp(argv[i], "-box") == 0 && i + 1 < argc) {
+            box_size = atoi(argv[i + 1]);
+            if (box_size < 2) {
+                fprintf(stderr, "Error: Invalid box size '%s'\n", argv[i + 1]);
+                exit(EXIT_FAILURE);
+            }
+            sudoku_size = box_size * box_size;
+            i += 2;
+        } else if (strcmp(argv[i], "-batch") == 0 && i + 1 < argc) {
+            batch_file = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "-queries") == 0 && i + 1 < argc) {
+            query_file = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "-enumerate") == 0 && i + 1 < argc) {
+            max_models = atoi(argv[i + 1]);
+            if (max_models < 1) {
+                fprintf(stderr, "Error: Invalid solution limit '%s'\n", argv[i + 1]);
+                exit(EXIT_FAILURE);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "-unique") == 0) {
+            unique_check = 1;
+            i++;
+        } else if (strcmp(argv[i], "-dimacs") == 0 && i + 1 < argc) {
+            dimacs_file = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "-dump-dimacs") == 0 && i + 1 < argc) {
+            dump_file = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "-stats") == 0 && i + 1 < argc) {
+            stats_file = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "-stats-format") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "json") == 0) stats_csv = 0;
+            else if (strcmp(argv[i + 1], "csv") == 0) stats_csv = 1;
+            else {
+                fprintf(stderr, "Error: Unknown statistics format '%s'\n", argv[i + 1]);
+                exit(EXIT_FAILURE);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[i + 1]);
+            if (num_threads <= 0) num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+            if (num_threads <= 0) num_threads = 1;
+            i += 2;
         } else if (strcmp(argv[i], "-bnf") == 0) {
             bnf = 1;
             if (i + 1 < argc && strchr(argv[i + 1], '=') == NULL) {
@@ -45,266 +208,365 @@ void parse_arguments(int argc, char *argv[]) {
         }
     }
 
+    if (unique_check && max_models) {
+        fprintf(stderr, "Error: -unique and -enumerate cannot be combined\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((unique_check || max_models) && (dimacs_file || query_file || compare_encodings)) {
+        fprintf(stderr, "Error: -unique and -enumerate apply to sudoku puzzles and BNF files only\n");
+        exit(EXIT_FAILURE);
+    }
+    if (preprocessing && (batch_file || query_file)) {
+        fprintf(stderr, "Error: -preprocess does not apply to -batch or -queries\n");
+        exit(EXIT_FAILURE);
+    }
+    if (max_models && batch_file) {
+        fprintf(stderr, "Error: -enumerate does not apply to batch mode, use -unique\n");
+        exit(EXIT_FAILURE);
+    }
+    if (stats_file && !DPLL_STATS) {
+        fprintf(stderr, "Error: -stats needs a build with DPLL_STATS enabled\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sudoku_board = calloc(sudoku_size * sudoku_size, sizeof(int));
+
     if (i < argc) {
         parse_sudoku_inputs(argc, argv, i);
-    } else if (!bnf_file) {
+    } else if (!bnf_file && !batch_file && !dimacs_file && !query_file) {
         fprintf(stderr, "Error: No BNF file or Sudoku inputs provided\n");
         exit(EXIT_FAILURE);
     }
 }
 
+// Parse one cell assignment. Returns 1 on success, 0 for a malformed
+// assignment and -1 when a number is out of range.
+int parse_cell_assignment(const char *text, int *row, int *col, int *val) {
+    int end = 0;
+
+    // {row},{col}={val} works for any grid size, {row}{col}={val} up to 9x9
+    if (strchr(text, ',') != NULL) {
+        if (sscanf(text, "%d,%d=%d%n", row, col, val, &end) != 3 || text[end] != '\0') return 0;
+    } else if (sudoku_size > 9 || sscanf(text, "%1d%1d=%d%n", row, col, val, &end) != 3 || text[end] != '\0') {
+        return 0;
+    }
+    if (*row < 1 || *row > sudoku_size || *col < 1 || *col > sudoku_size || *val < 1 || *val > sudoku_size) return -1;
+    return 1;
+}
+
 void parse_sudoku_inputs(int argc, char *argv[], int start_index) {
     for (int i = start_index; i < argc; i++) {
         int row, col, val;
-
-        if (sscanf(argv[i], "%1d%1d=%1d", &row, &col, &val) != 3) {
+        int parsed = parse_cell_assignment(argv[i], &row, &col, &val);
+        if (parsed == 0) {
             fprintf(stderr, "Error: Invalid input format '%s'\n", argv[i]);
             exit(EXIT_FAILURE);
         }
-
-        if (row < 1 || row > 9 || col < 1 || col > 9 || val < 1 || val > 9) {
+        if (parsed == -1) {
             fprintf(stderr, "Error: Values out of range in '%s'\n", argv[i]);
             exit(EXIT_FAILURE);
         }
 
-        if (sudoku_board[row - 1][col - 1] != 0) {
-            fprintf(stderr, "Error: Duplicate assignment at position %d%d\n", row, col);
+        if (sudoku_board[(row - 1) * sudoku_size + col - 1] != 0) {
+            fprintf(stderr, "Error: Duplicate assignment at position %d,%d\n", row, col);
             exit(EXIT_FAILURE);
         }
 
-        sudoku_board[row - 1][col - 1] = val;
+        sudoku_board[(row - 1) * sudoku_size + col - 1] = val;
     }
 }
 
 
+// Print a syntax error with the offending line and a caret under its position, then exit
+void report_syntax_error(const char *source, int line_number, const char *line, const struct SyntaxError *error) {
+    fprintf(stderr, "Error: %s:%d:%d: %s\n", source, line_number, error->position + 1, error->message);
+    fprintf(stderr, "  %s\n  %*s^\n", line, error->position, "");
+    exit(EXIT_FAILURE);
+}
+
+// Parse one BNF line and append its CNF clauses to out
+void convert_bnf_line(struct CNFOutput *out, const char *source, int line_number, const char *line) {
+    if (verbose) {
+        printf("BNF clause: %s\n", line);
+    }
+
+    struct SyntaxError error;
+    struct timespec start;
+    phase_start(&start);
+    Node* root = parseExpression(line, &error);
+    phase_end(PHASE_PARSE, &start);
+    if (error.message) {
+        report_syntax_error(source, line_number, line, &error);
+    }
+    int previousSize = out->set->size;
+    phase_start(&start);
+    if (tseitin) {
+        storeTseitinCNF(root, out);
+    } else {
+        internVariables(root, out);
+        root = removeBiconditional(root);
+        root = removeImplication(root);
+        root = applyDeMorgan(root);
+        root = removeDoubleNegation(root);
+        root = distributeOrOverAnd(root);
+        storeCNF(root, out);
+    }
+    resetNodeArena();  // The clauses are stored, drop the formula
+    phase_end(PHASE_CONVERT, &start);
+
+    if (verbose) {
+        printf("Converted CNF clauses:\n");
+        for (int clause = previousSize; clause < out->set->size; clause = nextClause(out->set, clause)) {
+            printClause(out, clause);
+        }
+        printf("\n");
+    }
+}
+
 void parse_bnf_file(const char *bnf_file) {
-    FILE *file = NULL;
-    char line[100];
-    char cnfExpressions[20000][100];
-    char bnfClauses[20000][100];  // Define the array to store BNF clauses if generated
-    int index = 0, numClauses = 0;
+    struct ClauseSet *set = createClauseSet();
+    struct SymbolTable *symbols = bnf_file ? createSymbolTable() : NULL;
+    struct CNFOutput out;
+    if (!set) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    initCNFOutput(&out, set, symbols);
 
-    // If bnf_file is provided, read from the file
+    // If bnf_file is provided, stream it line by line into the clause set
     if (bnf_file) {
-        file = fopen(bnf_file, "r");
+        FILE *file = fopen(bnf_file, "r");
         if (!file) {
             fprintf(stderr, "Error: Could not open BNF file '%s'\n", bnf_file);
             exit(EXIT_FAILURE);
         }
 
-        while (fgets(line, sizeof(line), file)) {
-            line[strcspn(line, "\n")] = 0;  // Remove newline
-            removeSpaces(line);
-
-            if (verbose) {
-                printf("BNF clause: %s\n", line);
-            }
-
-            // Process the BNF clause
-            Node* root = parseExpression(line, 0, strlen(line) - 1);
-            root = removeBiconditional(root);
-            root = removeImplication(root);
-            root = applyDeMorgan(root);
-            root = removeDoubleNegation(root);
-            root = distributeOrOverAnd(root);
-
-            int previousIndex = index;
-            storeCNF(root, cnfExpressions, &index);
-
-            if (verbose) {
-                printf("Converted CNF clauses:\n");
-                for (int i = previousIndex; i < index; i++) {
-                    printf("%s\n", cnfExpressions[i]);
-                }
-                printf("\n");
-            }
+        char *line = NULL;
+        size_t capacity = 0;
+        ssize_t length;
+        int line_number = 0;
+        while ((length = getline(&line, &capacity, file)) != -1) {
+            line_number++;
+            if (length > 0 && line[length - 1] == '\n') line[--length] = '\0';  // Remove newline
+            convert_bnf_line(&out, bnf_file, line_number, line);
         }
+        if (ferror(file)) {
+            fprintf(stderr, "Error: Could not read BNF file '%s'\n", bnf_file);
+            exit(EXIT_FAILURE);
+        }
+        free(line);
         fclose(file);
     } else {
-        // No file provided, generate BNF clauses dynamically
-        numClauses = generate_bnf_clauses(bnfClauses);  // Generate clauses
-
-        // Process the generated BNF clauses
-        for (int i = 0; i < numClauses; i++) {
-            strncpy(line, bnfClauses[i], sizeof(line));  // Copy the clause
-            removeSpaces(line);
-            if (verbose) {
-                printf("BNF clause: %s\n", line);
-            }
-
-            // Process the BNF clause
-            Node* root = parseExpression(line, 0, strlen(line) - 1);
-            root = removeBiconditional(root);
-            root = removeImplication(root);
-            root = applyDeMorgan(root);
-            root = removeDoubleNegation(root);
-            root = distributeOrOverAnd(root);
-
-            int previousIndex = index;
-            storeCNF(root, cnfExpressions, &index);
-
-            if (verbose) {
-                printf("Converted CNF clauses:\n");
-                for (int i = previousIndex; i < index; i++) {
-                    printf("%s\n", cnfExpressions[i]);
-                }
-                printf("\n");
-            }
-        }
+        // No file provided, generate the BNF clauses of the sudoku; its
+        // lines are parsed and converted as they are generated
+        struct timespec start;
+        double converted = phase_seconds[PHASE_PARSE] + phase_seconds[PHASE_CONVERT];
+        phase_start(&start);
+        generate_bnf_clauses(&out);
+        phase_end(PHASE_GENERATE, &start);
+        phase_seconds[PHASE_GENERATE] -= phase_seconds[PHASE_PARSE] + phase_seconds[PHASE_CONVERT] - converted;
     }
 
-    // Remove duplicates and sort CNF clauses (as before)
-    char uniqueCNF[20000][100];
-    int uniqueIndex = 0;
-    for (int i = 0; i < index; i++) {
-        if (!isDuplicate(uniqueCNF, uniqueIndex, cnfExpressions[i])) {
-            strcpy(uniqueCNF[uniqueIndex++], cnfExpressions[i]);
-        }
-    }
-
-    qsort(uniqueCNF, uniqueIndex, sizeof(uniqueCNF[0]), compareStrings);
+    freeNodeArena();
+    struct timespec start;
+    phase_start(&start);
+    canonicalizeClauses(set);
+    phase_end(PHASE_DEDUP, &start);
 
     if (verbose) {
         printf("ALL CNF clauses:\n");
-        for (int i = 0; i < uniqueIndex; i++) {
-            printf("%s\n", uniqueCNF[i]);
+        for (int clause = 0; clause < set->size; clause = nextClause(set, clause)) {
+            printClause(&out, clause);
         }
     }
 
-    // Continue processing the CNF clauses
-    struct Clause *root = readClauseSetFromInput(uniqueCNF, uniqueIndex, bnf_file ? 1 : -1);
+    struct Solver *solver = create_configured_solver(cnfVariableCount(&out));
+    if (dump_file) {
+        dump_dimacs(set, solver->variableNumber);
+    }
+
+    if (unique_check || max_models) {
+        // solutions differ in named variables, Tseitin auxiliaries only follow them
+        int count = 0;
+        int *projection = bnf_file ? malloc((solver->variableNumber + 1) * sizeof(int)) : sudoku_projection(NULL, &count);
+        if (!projection) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 1; bnf_file && i <= solver->variableNumber; i++) {
+            if (symbolName(symbols, i)[0] != AUXILIARY_PREFIX) projection[count++] = i;
+        }
+        char *solution_line = malloc(sudoku_size * sudoku_size + 1);
+        if (bnf_file) enumerate_solutions(set, projection, count, print_bnf_model, symbols);
+        else enumerate_solutions(set, projection, count, print_sudoku_model, solution_line);
+        free(solution_line);
+        free(projection);
+        freeSolver(solver);
+        freeCNFOutput(&out);
+        freeClauseSet(set);
+        freeSymbolTable(symbols);
+        return;
+    }
 
-    int result = dpll(root);
+    phase_start(&start);
+    int result = solve_clause_set(solver, set);
+    phase_end(PHASE_SOLVE, &start);
     if(verbose){
         printf(result == SATISFIABLE ? "SATISFIABLE\n" : "UNSATISFIABLE\n");
     }
 
-    writeSolutionToOutput(root, valuation, bnf_file ? 1 : -1);
+    writeSolutionToOutput(solver, bnf_file ? 1 : -1, symbols);
+    record_solver_stats(solver, result);
+    freeSolver(solver);
+    freeCNFOutput(&out);
+    freeClauseSet(set);
+    freeSymbolTable(symbols);
 }
 
 
 void print_sudoku_board() {
     printf("Initial Sudoku Board:\n");
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            printf("%d ", sudoku_board[i][j]);
-        }
-        printf("\n");
+    for (int i = 0; i < sudoku_size; i++) {
+        print_board_row(sudoku_board + i * sudoku_size);
     }
 }
 
+// Print one board row, padding values to the width of the largest value
+void print_board_row(const int *row) {
+    int width = snprintf(NULL, 0, "%d", sudoku_size);
+    for (int j = 0; j < sudoku_size; j++) {
+        printf("%*d ", width, row[j]);
+    }
+    printf("\n");
+}
 
 
-int generate_bnf_clauses(char bnfClauses[10000][100]) {
-    int index = 0;
+
+// Generated BNF line under construction, long enough for a disjunction of
+// sudoku_size variables
+struct BnfLine {
+    char *text;
+    int length;
+    int capacity;
+    int number;
+};
+
+// Append a variable to the line, separated from the previous one by " v "
+void append_bnf_variable(struct BnfLine *line, int num, int row, int col) {
+    line->length += snprintf(line->text + line->length, line->capacity - line->length, "%sn%d_r%d_c%d",
+                             line->length > 1 ? " v " : "", num, row, col);
+}
+
+// Close the line and convert it
+void emit_bnf_line(struct CNFOutput *out, struct BnfLine *line) {
+    snprintf(line->text + line->length, line->capacity - line->length, ")");
+    convert_bnf_line(out, "generated BNF", ++line->number, line->text);
+    line->length = snprintf(line->text, line->capacity, "(");
+}
+
+// Emit the pairwise exclusion (!n{num1}_r{row1}_c{col1} v !n{num2}_r{row2}_c{col2})
+void emit_bnf_exclusion(struct CNFOutput *out, struct BnfLine *line, int num1, int row1, int col1, int num2, int row2, int col2) {
+    line->length += snprintf(line->text + line->length, line->capacity - line->length, "!n%d_r%d_c%d v !n%d_r%d_c%d",
+                             num1, row1, col1, num2, row2, col2);
+    emit_bnf_line(out, line);
+}
+
+void generate_bnf_clauses(struct CNFOutput *out) {
+    int digits = snprintf(NULL, 0, "%d", sudoku_size);
+    struct BnfLine line = { NULL, 0, sudoku_size * (3 * digits + 8) + 3, 0 };
+    line.text = malloc(line.capacity);
+    if (!line.text) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
 
     // Store BNF clauses for initial values
-    for (int row = 0; row < SIZE; row++) {
-        for (int col = 0; col < SIZE; col++) {
-            if (sudoku_board[row][col] != 0) {
-                snprintf(bnfClauses[index++], 100, "n%d_r%d_c%d", sudoku_board[row][col], row + 1, col + 1);
+    for (int row = 0; row < sudoku_size; row++) {
+        for (int col = 0; col < sudoku_size; col++) {
+            if (sudoku_board[row * sudoku_size + col] != 0) {
+                snprintf(line.text, line.capacity, "n%d_r%d_c%d", sudoku_board[row * sudoku_size + col], row + 1, col + 1);
+                convert_bnf_line(out, "generated BNF", ++line.number, line.text);
             }
         }
     }
+    line.length = snprintf(line.text, line.capacity, "(");
 
     // Cell constraint: each cell must contain exactly one number
-    for (int row = 1; row <= SIZE; row++) {
-        for (int col = 1; col <= SIZE; col++) {
+    for (int row = 1; row <= sudoku_size; row++) {
+        for (int col = 1; col <= sudoku_size; col++) {
             // At least one number in each cell
-            char clause[500] = "(";
-            for (int num = 1; num <= SIZE; num++) {
-                char part[50];
-                snprintf(part, 50, "n%d_r%d_c%d", num, row, col);
-                strcat(clause, part);
-                if (num < SIZE) strcat(clause, " v ");
+            for (int num = 1; num <= sudoku_size; num++) {
+                append_bnf_variable(&line, num, row, col);
             }
-            strcat(clause, ")");
-            snprintf(bnfClauses[index++], 500, "%s", clause);
+            emit_bnf_line(out, &line);
 
             // No more than one number in each cell (pairwise exclusion)
-            for (int num1 = 1; num1 <= SIZE; num1++) {
-                for (int num2 = num1 + 1; num2 <= SIZE; num2++) {
-                    snprintf(bnfClauses[index++], 100, "(!n%d_r%d_c%d v !n%d_r%d_c%d)", num1, row, col, num2, row, col);
+            for (int num1 = 1; num1 <= sudoku_size; num1++) {
+                for (int num2 = num1 + 1; num2 <= sudoku_size; num2++) {
+                    emit_bnf_exclusion(out, &line, num1, row, col, num2, row, col);
                 }
             }
         }
     }
 
     // Row constraint: each number must appear exactly once in each row
-    for (int num = 1; num <= SIZE; num++) {
-        for (int row = 1; row <= SIZE; row++) {
+    for (int num = 1; num <= sudoku_size; num++) {
+        for (int row = 1; row <= sudoku_size; row++) {
             // At least one number in the row
-            char clause[500] = "(";
-            for (int col = 1; col <= SIZE; col++) {
-                char part[50];
-                snprintf(part, 50, "n%d_r%d_c%d", num, row, col);
-                strcat(clause, part);
-                if (col < SIZE) strcat(clause, " v ");
+            for (int col = 1; col <= sudoku_size; col++) {
+                append_bnf_variable(&line, num, row, col);
             }
-            strcat(clause, ")");
-            snprintf(bnfClauses[index++], 500, "%s", clause);
+            emit_bnf_line(out, &line);
 
             // No more than one number in each row (pairwise exclusion)
-            for (int col1 = 1; col1 <= SIZE; col1++) {
-                for (int col2 = col1 + 1; col2 <= SIZE; col2++) {
-                    snprintf(bnfClauses[index++], 100, "(!n%d_r%d_c%d v !n%d_r%d_c%d)", num, row, col1, num, row, col2);
+            for (int col1 = 1; col1 <= sudoku_size; col1++) {
+                for (int col2 = col1 + 1; col2 <= sudoku_size; col2++) {
+                    emit_bnf_exclusion(out, &line, num, row, col1, num, row, col2);
                 }
             }
         }
     }
 
     // Column constraint: each number must appear exactly once in each column
-    for (int num = 1; num <= SIZE; num++) {
-        for (int col = 1; col <= SIZE; col++) {
+    for (int num = 1; num <= sudoku_size; num++) {
+        for (int col = 1; col <= sudoku_size; col++) {
             // At least one number in the column
-            char clause[500] = "(";
-            for (int row = 1; row <= SIZE; row++) {
-                char part[50];
-                snprintf(part, 50, "n%d_r%d_c%d", num, row, col);
-                strcat(clause, part);
-                if (row < SIZE) strcat(clause, " v ");
+            for (int row = 1; row <= sudoku_size; row++) {
+                append_bnf_variable(&line, num, row, col);
             }
-            strcat(clause, ")");
-            snprintf(bnfClauses[index++], 500, "%s", clause);
+            emit_bnf_line(out, &line);
 
             // No more than one number in each column (pairwise exclusion)
-            for (int row1 = 1; row1 <= SIZE; row1++) {
-                for (int row2 = row1 + 1; row2 <= SIZE; row2++) {
-                    snprintf(bnfClauses[index++], 100, "(!n%d_r%d_c%d v !n%d_r%d_c%d)", num, row1, col, num, row2, col);
+            for (int row1 = 1; row1 <= sudoku_size; row1++) {
+                for (int row2 = row1 + 1; row2 <= sudoku_size; row2++) {
+                    emit_bnf_exclusion(out, &line, num, row1, col, num, row2, col);
                 }
             }
         }
     }
 
     // Block constraint: each number must appear exactly once in each block
-    for (int num = 1; num <= SIZE; num++) {
-        for (int blockRow = 0; blockRow < 3; blockRow++) {
-            for (int blockCol = 0; blockCol < 3; blockCol++) {
+    for (int num = 1; num <= sudoku_size; num++) {
+        for (int blockRow = 0; blockRow < box_size; blockRow++) {
+            for (int blockCol = 0; blockCol < box_size; blockCol++) {
                 // At least one number in the block
-                char clause[500] = "(";
-                for (int i = 1; i <= 3; i++) {
-                    for (int j = 1; j <= 3; j++) {
-                        int row = blockRow * 3 + i;
-                        int col = blockCol * 3 + j;
-                        char part[50];
-                        snprintf(part, 50, "n%d_r%d_c%d", num, row, col);
-                        strcat(clause, part);
-                        if (!(i == 3 && j == 3)) strcat(clause, " v ");
+                for (int i = 1; i <= box_size; i++) {
+                    for (int j = 1; j <= box_size; j++) {
+                        append_bnf_variable(&line, num, blockRow * box_size + i, blockCol * box_size + j);
                     }
                 }
-                strcat(clause, ")");
-                snprintf(bnfClauses[index++], 500, "%s", clause);
+                emit_bnf_line(out, &line);
 
                 // No more than one number in each block (pairwise exclusion)
-                for (int i1 = 1; i1 <= 3; i1++) {
-                    for (int j1 = 1; j1 <= 3; j1++) {
-                        int row1 = blockRow * 3 + i1;
-                        int col1 = blockCol * 3 + j1;
-                        for (int i2 = i1; i2 <= 3; i2++) {
-                            for (int j2 = (i2 == i1 ? j1 + 1 : 1); j2 <= 3; j2++) {
-                                int row2 = blockRow * 3 + i2;
-                                int col2 = blockCol * 3 + j2;
-                                snprintf(bnfClauses[index++], 100, "(!n%d_r%d_c%d v !n%d_r%d_c%d)", num, row1, col1, num, row2, col2);
+                for (int i1 = 1; i1 <= box_size; i1++) {
+                    for (int j1 = 1; j1 <= box_size; j1++) {
+                        int row1 = blockRow * box_size + i1;
+                        int col1 = blockCol * box_size + j1;
+                        for (int i2 = i1; i2 <= box_size; i2++) {
+                            for (int j2 = (i2 == i1 ? j1 + 1 : 1); j2 <= box_size; j2++) {
+                                int row2 = blockRow * box_size + i2;
+                                int col2 = blockCol * box_size + j2;
+                                emit_bnf_exclusion(out, &line, num, row1, col1, num, row2, col2);
                             }
                         }
                     }
@@ -313,118 +575,971 @@ int generate_bnf_clauses(char bnfClauses[10000][100]) {
         }
     }
 
-    return index;
+    free(line.text);
 }
 
 
-void generate_cnf_clauses() {
-    char cnfClauses[10000][100];
-    int index = 0;
+// Variable index of "cell (row, col) holds val", numbered as in the BNF conversion
+int sudoku_variable(int val, int row, int col) {
+    return (val - 1) + (row - 1) * sudoku_size + (col - 1) * sudoku_size * sudoku_size + 1;
+}
 
-    // Generate CNF clauses for initial known values
-    for (int row = 0; row < SIZE; row++) {
-        for (int col = 0; col < SIZE; col++) {
-            if (sudoku_board[row][col] != 0) {
-                // Store in the format n{value}_r{row+1}_c{col+1}
-                snprintf(cnfClauses[index++], 100, "n%d_r%d_c%d", sudoku_board[row][col], row + 1, col + 1);
+// Print the clause set in the n{val}_r{row}_c{col} text form, auxiliary
+// variables of the at-most-one encodings as #1, #2, ...
+void print_sudoku_clause_set(struct ClauseSet *set) {
+    int cell_variables = sudoku_size * sudoku_size * sudoku_size;
+    for (int c = 0; c < set->size; c = nextClause(set, c)) {
+        int *literals = clauseLiterals(set, c);
+        for (int i = 0; i < clauseSize(set, c); i++) {
+            int index = abs(literals[i]) - 1;
+            if (index >= cell_variables) {
+                printf("%s%s#%d", i > 0 ? " " : "", literals[i] < 0 ? "!" : "", index - cell_variables + 1);
+                continue;
             }
+            printf("%s%sn%d_r%d_c%d", i > 0 ? " " : "", literals[i] < 0 ? "!" : "",
+                   index % sudoku_size + 1, (index / sudoku_size) % sudoku_size + 1, index / (sudoku_size * sudoku_size) + 1);
         }
+        printf("\n");
     }
+}
+
+// Create a solver with the options given on the command line
+struct Solver *create_configured_solver(int variables) {
+    struct Solver *solver = createSolver(variables);
+    if (solver == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    solver->verbose = verbose;
+    solver->cdcl = cdcl;
+    solver->heuristic = heuristic;
+    return solver;
+}
+
+// Run the search, preprocessing the clauses first when requested. The model
+// in solver->valuation always covers the original clauses.
+int solve_clause_set(struct Solver *solver, struct ClauseSet *set) {
+    if (!preprocessing) {
+        return dpll(solver, set);
+    }
+
+    struct Preprocessor *preprocessor = createPreprocessor(solver->variableNumber);
+    int result = preprocessor ? preprocess(preprocessor, set) : SOLVER_ERROR;
+    if (result == SOLVER_ERROR) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (verbose) {
+        const struct PreprocessStats *stats = &preprocessor->stats;
+        printf("Preprocessing: %d -> %d clauses, %d fixed variables, %d failed literals, %d subsumed clauses, "
+               "%d strengthened clauses, %d eliminated variables\n", stats->clausesBefore, stats->clausesAfter,
+               stats->fixedVariables, stats->failedLiterals, stats->subsumedClauses, stats->strengthenedClauses,
+               stats->eliminatedVariables);
+        printf("Preprocessing time: probing %.6f s, subsumption %.6f s, strengthening %.6f s, elimination %.6f s\n",
+               stats->probingSeconds, stats->subsumptionSeconds, stats->strengtheningSeconds, stats->eliminationSeconds);
+    }
+
+    result = dpll(solver, set);
+    if (result == SATISFIABLE) {
+        reconstructModel(preprocessor, solver->valuation);
+    }
+    freePreprocessor(preprocessor);
+    return result;
+}
+
+// Encode the puzzle in sudoku_board and solve it
+void generate_cnf_clauses() {
+    struct SudokuEncoder encoder;
+    struct timespec start, end;
+    phase_start(&start);
+    init_sudoku_encoder(&encoder, amo_encoding, compact ? sudoku_board : NULL);
+
+    // Generate unit clauses for initial known values
+    generate_clue_clauses(&encoder, sudoku_board);
 
     // Generate Sudoku constraints in CNF form
-    generate_at_least_one_digit_clauses(cnfClauses, &index);
-    generate_unique_row_clauses(cnfClauses, &index);
-    generate_unique_column_clauses(cnfClauses, &index);
-    generate_unique_block_clauses(cnfClauses, &index);
+    generate_sudoku_constraints(&encoder);
+    phase_end(PHASE_GENERATE, &start);
 
+    struct ClauseSet *set = encoder.set;
+    struct Solver *solver = create_configured_solver(encoder.variables);
     if (verbose) {
         printf("Generated CNF Clauses:\n");
-        for (int i = 0; i < index; i++) {
-            printf("%s\n", cnfClauses[i]);
-        }
+        print_sudoku_clause_set(set);
+        printf("Encoding: %s%s, %d variables, %d clauses\n", amo_encoding_names[amo_encoding],
+               compact ? " compact" : "", encoder.variables, set->count);
+    }
+    if (dump_file) {
+        dump_dimacs(set, solver->variableNumber);
+    }
+    if (unique_check || max_models) {
+        int count;
+        int *projection = sudoku_projection(encoder.open, &count);
+        char *solution_line = malloc(sudoku_size * sudoku_size + 1);
+        enumerate_solutions(set, projection, count, print_sudoku_model, solution_line);
+        free(solution_line);
+        free(projection);
+        freeSolver(solver);
+        free_sudoku_encoder(&encoder);
+        return;
     }
 
-    struct Clause *root = readClauseSetFromInput(cnfClauses, index, bnf);
-
-    int result = dpll(root);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = solve_clause_set(solver, set);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    phase_seconds[PHASE_SOLVE] += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (verbose) {
+        printf("Solve time: %.6f s\n", (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    }
     if (result == SATISFIABLE) {
         if(verbose){
             printf("SATISFIABLE\n");
         }
-        writeSolutionToOutput(root, valuation, bnf);
+        writeSolutionToOutput(solver, bnf, NULL);
     } else {
         if(verbose){
             printf("UNSATISFIABLE\n");
         }
     }
+    record_solver_stats(solver, result);
+    freeSolver(solver);
+    free_sudoku_encoder(&encoder);
+}
+
+// Encode and solve the puzzle with every at-most-one encoding, with and
+// without clue pre-simplification, and report size and time of each
+void compare_sudoku_encodings() {
+    printf("%-11s %-6s %10s %10s %12s %12s  %s\n", "Encoding", "Clues", "Variables", "Clauses", "Encode (s)", "Solve (s)", "Result");
+    for (int amo = AMO_PAIRWISE; amo <= AMO_PRODUCT; amo++) {
+        for (int simplify = 0; simplify <= 1; simplify++) {
+            struct SudokuEncoder encoder;
+            struct timespec start, encoded, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            init_sudoku_encoder(&encoder, amo, simplify ? sudoku_board : NULL);
+            generate_clue_clauses(&encoder, sudoku_board);
+            generate_sudoku_constraints(&encoder);
+            clock_gettime(CLOCK_MONOTONIC, &encoded);
 
+            int clauses = encoder.set->count;
+            struct Solver *solver = create_configured_solver(encoder.variables);
+            int result = solve_clause_set(solver, encoder.set);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            printf("%-11s %-6s %10d %10d %12.6f %12.6f  %s\n", amo_encoding_names[amo], simplify ? "fixed" : "all",
+                   encoder.variables, clauses,
+                   (encoded.tv_sec - start.tv_sec) + (encoded.tv_nsec - start.tv_nsec) / 1e9,
+                   (end.tv_sec - encoded.tv_sec) + (end.tv_nsec - encoded.tv_nsec) / 1e9,
+                   result == SATISFIABLE ? "SATISFIABLE" : "UNSATISFIABLE");
+            freeSolver(solver);
+            free_sudoku_encoder(&encoder);
+        }
+    }
+}
+
+// Set up an encoder with a fresh clause set. With a board, every variable
+// that contradicts a clue in its cell, row, column or block is left out of
+// the encoding, so those cells and digits never reach the solver.
+void init_sudoku_encoder(struct SudokuEncoder *encoder, int amo, const int *board) {
+    int n = sudoku_size;
+    encoder->set = createClauseSet();
+    encoder->amo = amo;
+    encoder->board = board;
+    encoder->variables = n * n * n;
+    encoder->open = malloc(n * n * n + 1);
+    if (!encoder->set || !encoder->open) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(encoder->open, 1, n * n * n + 1);
+    if (!board) return;
+
+    // digits placed by clues in each row, column and block
+    char used_row[n][n + 1], used_col[n][n + 1], used_block[n][n + 1];
+    memset(used_row, 0, sizeof(used_row));
+    memset(used_col, 0, sizeof(used_col));
+    memset(used_block, 0, sizeof(used_block));
+    for (int cell = 0; cell < n * n; cell++) {
+        int row = cell / n, col = cell % n, val = board[cell];
+        used_row[row][val] = used_col[col][val] = used_block[row / box_size * box_size + col / box_size][val] = 1;
+    }
+
+    for (int row = 0; row < n; row++) {
+        for (int col = 0; col < n; col++) {
+            int clue = board[row * n + col];
+            for (int val = 1; val <= n; val++) {
+                int open = clue ? val == clue
+                                : !used_row[row][val] && !used_col[col][val] && !used_block[row / box_size * box_size + col / box_size][val];
+                encoder->open[sudoku_variable(val, row + 1, col + 1)] = (char) open;
+            }
+        }
+    }
+}
+
+void free_sudoku_encoder(struct SudokuEncoder *encoder) {
+    freeClauseSet(encoder->set);
+    free(encoder->open);
+}
+
+// Add a unit clause for every clue of board
+void generate_clue_clauses(struct SudokuEncoder *encoder, const int *board) {
+    for (int row = 0; row < sudoku_size; row++) {
+        for (int col = 0; col < sudoku_size; col++) {
+            if (board[row * sudoku_size + col] != 0) {
+                int literal = sudoku_variable(board[row * sudoku_size + col], row + 1, col + 1);
+                addClause(encoder->set, &literal, 1, 0);
+            }
+        }
+    }
+}
+
+// Generate the sudoku rules; without a board they are clue-independent and shared by every puzzle of a given size
+void generate_sudoku_constraints(struct SudokuEncoder *encoder) {
+    generate_at_least_one_digit_clauses(encoder);
+    generate_unique_row_clauses(encoder);
+    generate_unique_column_clauses(encoder);
+    generate_unique_block_clauses(encoder);
 }
 
 // Ensure each cell has at least one digit
-void generate_at_least_one_digit_clauses(char cnf[][100], int *index) {
-    for (int row = 1; row <= SIZE; row++) {
-        for (int col = 1; col <= SIZE; col++) {
-            char clause[100] = "";
-            for (int val = 1; val <= SIZE; val++) {
-                char literal[16];
-                snprintf(literal, sizeof(literal), "n%d_r%d_c%d ", val, row, col);
-                strcat(clause, literal);
+void generate_at_least_one_digit_clauses(struct SudokuEncoder *encoder) {
+    int literals[sudoku_size];
+    for (int row = 1; row <= sudoku_size; row++) {
+        for (int col = 1; col <= sudoku_size; col++) {
+            // clue cells are settled by their unit clause
+            if (encoder->board && encoder->board[(row - 1) * sudoku_size + col - 1] != 0) continue;
+            int count = 0;
+            for (int val = 1; val <= sudoku_size; val++) {
+                if (encoder->open[sudoku_variable(val, row, col)]) literals[count++] = sudoku_variable(val, row, col);
             }
-            strcpy(cnf[(*index)++], clause);
+            addClause(encoder->set, literals, count, 0);
         }
     }
 }
 
 // Ensure each number appears at most once per row
-void generate_unique_row_clauses(char cnf[][100], int *index) {
-    for (int row = 1; row <= SIZE; row++) {
-        for (int val = 1; val <= SIZE; val++) {
-            for (int col1 = 1; col1 <= SIZE; col1++) {
-                for (int col2 = col1 + 1; col2 <= SIZE; col2++) {
-                    snprintf(cnf[(*index)++], 100, "!n%d_r%d_c%d !n%d_r%d_c%d", val, row, col1, val, row, col2);
-                }
+void generate_unique_row_clauses(struct SudokuEncoder *encoder) {
+    int variables[sudoku_size];
+    for (int row = 1; row <= sudoku_size; row++) {
+        for (int val = 1; val <= sudoku_size; val++) {
+            int count = 0;
+            for (int col = 1; col <= sudoku_size; col++) {
+                if (encoder->open[sudoku_variable(val, row, col)]) variables[count++] = sudoku_variable(val, row, col);
             }
+            add_at_most_one(encoder, variables, count);
         }
     }
 }
 
 // Ensure each number appears at most once per column
-void generate_unique_column_clauses(char cnf[][100], int *index) {
-    for (int col = 1; col <= SIZE; col++) {
-        for (int val = 1; val <= SIZE; val++) {
-            for (int row1 = 1; row1 <= SIZE; row1++) {
-                for (int row2 = row1 + 1; row2 <= SIZE; row2++) {
-                    snprintf(cnf[(*index)++], 100, "!n%d_r%d_c%d !n%d_r%d_c%d", val, row1, col, val, row2, col);
+void generate_unique_column_clauses(struct SudokuEncoder *encoder) {
+    int variables[sudoku_size];
+    for (int col = 1; col <= sudoku_size; col++) {
+        for (int val = 1; val <= sudoku_size; val++) {
+            int count = 0;
+            for (int row = 1; row <= sudoku_size; row++) {
+                if (encoder->open[sudoku_variable(val, row, col)]) variables[count++] = sudoku_variable(val, row, col);
+            }
+            add_at_most_one(encoder, variables, count);
+        }
+    }
+}
+
+// Ensure each number appears at most once per block
+void generate_unique_block_clauses(struct SudokuEncoder *encoder) {
+    int variables[sudoku_size];
+    for (int val = 1; val <= sudoku_size; val++) {
+        for (int block_row = 0; block_row < box_size; block_row++) {
+            for (int block_col = 0; block_col < box_size; block_col++) {
+                int count = 0;
+                for (int cell = 0; cell < sudoku_size; cell++) {
+                    int row = block_row * box_size + cell / box_size + 1;
+                    int col = block_col * box_size + cell % box_size + 1;
+                    if (encoder->open[sudoku_variable(val, row, col)]) variables[count++] = sudoku_variable(val, row, col);
                 }
+                add_at_most_one(encoder, variables, count);
             }
         }
     }
 }
 
-// Ensure each number appears at most once per 3x3 block
-void generate_unique_block_clauses(char cnf[][100], int *index) {
-    for (int val = 1; val <= SIZE; val++) {
-        for (int block_row = 0; block_row < 3; block_row++) {
-            for (int block_col = 0; block_col < 3; block_col++) {
-                for (int cell1 = 0; cell1 < 9; cell1++) {
-                    for (int cell2 = cell1 + 1; cell2 < 9; cell2++) {
-                        int row1 = block_row * 3 + cell1 / 3 + 1;
-                        int col1 = block_col * 3 + cell1 % 3 + 1;
-                        int row2 = block_row * 3 + cell2 / 3 + 1;
-                        int col2 = block_col * 3 + cell2 % 3 + 1;
-                        snprintf(cnf[(*index)++], 100, "!n%d_r%d_c%d !n%d_r%d_c%d", val, row1, col1, val, row2, col2);
-                    }
+void add_binary_clause(struct SudokuEncoder *encoder, int literal1, int literal2) {
+    int literals[2] = {literal1, literal2};
+    addClause(encoder->set, literals, 2, 0);
+}
+
+// At most one of the count variables is true, in the encoder's encoding.
+// Auxiliary variables are numbered after the cell variables; small groups
+// always use pairwise clauses, which are the smallest encoding there.
+void add_at_most_one(struct SudokuEncoder *encoder, const int *variables, int count) {
+    if (count < 2) return;
+    if (encoder->amo == AMO_PAIRWISE || count <= AMO_PAIRWISE_LIMIT) {
+        for (int i = 0; i < count; i++) {
+            for (int j = i + 1; j < count; j++) {
+                add_binary_clause(encoder, -variables[i], -variables[j]);
+            }
+        }
+    } else if (encoder->amo == AMO_SEQUENTIAL) {
+        // s_i is true when one of the first i variables is
+        int previous = ++encoder->variables;
+        add_binary_clause(encoder, -variables[0], previous);
+        for (int i = 1; i < count - 1; i++) {
+            int counter = ++encoder->variables;
+            add_binary_clause(encoder, -variables[i], counter);
+            add_binary_clause(encoder, -previous, counter);
+            add_binary_clause(encoder, -variables[i], -previous);
+            previous = counter;
+        }
+        add_binary_clause(encoder, -variables[count - 1], -previous);
+    } else if (encoder->amo == AMO_COMMANDER) {
+        // groups of three, each implying its commander; at most one commander is true
+        int commanders[(count + 2) / 3], groups = 0;
+        for (int start = 0; start < count; start += 3) {
+            int size = count - start < 3 ? count - start : 3;
+            if (size == 1) {
+                commanders[groups++] = variables[start];
+                continue;
+            }
+            int commander = ++encoder->variables;
+            for (int i = start; i < start + size; i++) {
+                for (int j = i + 1; j < start + size; j++) {
+                    add_binary_clause(encoder, -variables[i], -variables[j]);
                 }
+                add_binary_clause(encoder, -variables[i], commander);
+            }
+            commanders[groups++] = commander;
+        }
+        add_at_most_one(encoder, commanders, groups);
+    } else {
+        // variables on a rows x columns grid imply their row and column
+        int rows = 1;
+        while (rows * rows < count) rows++;
+        int columns = (count + rows - 1) / rows;
+        int row_variables[rows], column_variables[columns];
+        for (int r = 0; r < rows; r++) row_variables[r] = ++encoder->variables;
+        for (int c = 0; c < columns; c++) column_variables[c] = ++encoder->variables;
+        for (int i = 0; i < count; i++) {
+            add_binary_clause(encoder, -variables[i], row_variables[i / columns]);
+            add_binary_clause(encoder, -variables[i], column_variables[i % columns]);
+        }
+        add_at_most_one(encoder, row_variables, rows);
+        add_at_most_one(encoder, column_variables, columns);
+    }
+}
+
+
+// Read one puzzle line of sudoku_size^2 cells into board. Empty cells are
+// '.' or '0', values are '1'-'9' followed by 'A', 'B', ... for 10 and up.
+// Returns 0 if the line is malformed.
+int parse_puzzle_line(const char *line, int *board) {
+    int cells = sudoku_size * sudoku_size;
+    for (int i = 0; i < cells; i++) {
+        char c = line[i];
+        int val;
+        if (c == '.' || c == '0') val = 0;
+        else if (c >= '1' && c <= '9') val = c - '0';
+        else if (c >= 'A' && c <= 'Z') val = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'z') val = c - 'a' + 10;
+        else return 0;
+        if (val > sudoku_size) return 0;
+        board[i] = val;
+    }
+    return line[cells] == '\0' || line[cells] == '\n' || line[cells] == '\r';
+}
+
+// Write the solved grid in the puzzle file format, one character per cell,
+// into line of sudoku_size^2 + 1 characters
+void format_solution_line(const struct Solver *solver, char *line) {
+    int cells = sudoku_size * sudoku_size;
+    for (int i = 1; i <= cells * sudoku_size; i++) {
+        if (solver->valuation[i] == 1) {
+            int val = (i - 1) % sudoku_size + 1;
+            int cell = ((i - 1) / sudoku_size) % sudoku_size * sudoku_size + (i - 1) / cells;
+            line[cell] = val <= 9 ? '0' + val : 'A' + val - 10;
+        }
+    }
+    line[cells] = '\0';
+}
+
+// Work-stealing scheduler for batch mode: every worker owns a contiguous
+// range of puzzle indices and takes puzzles from its front. A worker whose
+// range runs dry steals the back half of the largest remaining range.
+struct WorkQueue {
+    pthread_mutex_t lock;
+    int next;  // next puzzle to solve
+    int end;   // one past the last puzzle owned
+};
+
+struct BatchJob {
+    const char *puzzles;     // count puzzles of cells characters each
+    char *solutions;         // count lines of cells + 1 characters each
+    char *solved;            // whether each puzzle was solved; with -unique its solutions found, up to 2
+    int count;
+    int cells;
+    const struct ClauseSet *rules;  // rules shared by every puzzle, empty with -compact
+    int variables;           // variables of the rules, auxiliaries included
+    const int *projection;   // cell variables, which tell solutions apart for -unique
+    int projected;           // size of projection
+    struct WorkQueue *queues;
+    int workers;
+};
+
+struct BatchWorker {
+    struct BatchJob *job;
+    int id;
+    pthread_t thread;
+    struct SolverStats stats;  // counters of the worker's solver
+};
+
+// Take the next puzzle of a worker, stealing when its own range is empty.
+// Returns -1 once no range has work left.
+int take_puzzle(struct BatchJob *job, int id) {
+    struct WorkQueue *own = &job->queues[id];
+    pthread_mutex_lock(&own->lock);
+    if (own->next < own->end) {
+        int puzzle = own->next++;
+        pthread_mutex_unlock(&own->lock);
+        return puzzle;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    while (1) {
+        // pick the victim with the most work left; the sizes are only a hint
+        int victim = -1, most = 0;
+        for (int w = 0; w < job->workers; w++) {
+            struct WorkQueue *queue = &job->queues[w];
+            pthread_mutex_lock(&queue->lock);
+            int remaining = queue->end - queue->next;
+            pthread_mutex_unlock(&queue->lock);
+            if (w != id && remaining > most) {
+                most = remaining;
+                victim = w;
             }
         }
+        if (victim == -1) return -1;
+
+        struct WorkQueue *queue = &job->queues[victim];
+        pthread_mutex_lock(&queue->lock);
+        int remaining = queue->end - queue->next;
+        int stolen = (remaining + 1) / 2;
+        int start = queue->end - stolen;
+        queue->end = start;
+        pthread_mutex_unlock(&queue->lock);
+        if (stolen == 0) continue;
+
+        pthread_mutex_lock(&own->lock);
+        own->next = start + 1;
+        own->end = start + stolen;
+        pthread_mutex_unlock(&own->lock);
+        return start;
     }
 }
 
+// Solve puzzles with a private solver and a private copy of the rules. Each
+// puzzle only appends its clue units, which are dropped again together with
+// any learned clauses before the next one.
+void *batch_worker(void *arg) {
+    struct BatchWorker *worker = arg;
+    struct BatchJob *job = worker->job;
+    struct Solver *solver = create_configured_solver(job->variables);
+    struct ClauseSet *set = copyClauseSet(job->rules);
+    int *board = malloc(job->cells * sizeof(int));
+    const int *projection = job->projection;
+    int projected = job->projected;
+    int *puzzle_projection = NULL;
+
+    int puzzle;
+    while ((puzzle = take_puzzle(job, worker->id)) != -1) {
+        parse_puzzle_line(job->puzzles + (size_t) puzzle * job->cells, board);
+        if (compact) {
+            // encode the rules simplified by this puzzle's clues
+            struct SudokuEncoder encoder;
+            init_sudoku_encoder(&encoder, amo_encoding, board);
+            generate_clue_clauses(&encoder, board);
+            generate_sudoku_constraints(&encoder);
+            freeClauseSet(set);
+            set = encoder.set;
+            if (unique_check) {
+                free(puzzle_projection);
+                puzzle_projection = sudoku_projection(encoder.open, &projected);
+                projection = puzzle_projection;
+            }
+            free(encoder.open);
+            if (reserveVariables(solver, encoder.variables) != SOLVER_OK) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            truncateClauseSet(set, job->rules->size, job->rules->count);
+            for (int i = 0; i < job->cells; i++) {
+                if (board[i] != 0) {
+                    int literal = sudoku_variable(board[i], i / sudoku_size + 1, i % sudoku_size + 1);
+                    addClause(set, &literal, 1, 0);
+                }
+            }
+        }
+        if (unique_check) {
+            solver->clauses = set;
+            int found = solver_enumerate(solver, projection, projected, 2, NULL, NULL);
+            if (found == SOLVER_ERROR) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+            if (found > 0) format_solution_line(solver, job->solutions + (size_t) puzzle * (job->cells + 1));
+            job->solved[puzzle] = (char) found;
+            continue;
+        }
+        if (dpll(solver, set) != SATISFIABLE) continue;
+
+        format_solution_line(solver, job->solutions + (size_t) puzzle * (job->cells + 1));
+        job->solved[puzzle] = 1;
+    }
+
+    free(board);
+    free(puzzle_projection);
+    freeClauseSet(set);
+    add_solver_stats(&worker->stats, &solver->stats);
+    freeSolver(solver);
+    return NULL;
+}
+
+// Solve every puzzle of a file on num_threads workers. The sudoku rules are
+// generated once and shared read-only; solutions are printed in input order.
+void solve_batch_file(const char *filename) {
+    struct timespec start, end;
+    phase_start(&start);
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open puzzle file '%s'\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    int cells = sudoku_size * sudoku_size;
+    int *board = malloc(cells * sizeof(int));
+    if (!board) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    char *puzzles = NULL;
+    int count = 0, capacity = 0, line_number = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    while (getline(&line, &line_capacity, file) != -1) {
+        line_number++;
+        if (line[0] == '\n' || line[0] == '\r' || line[0] == '#' || line[0] == '\0') continue;
+        if (!parse_puzzle_line(line, board)) {
+            fprintf(stderr, "Error: Invalid puzzle on line %d of '%s'\n", line_number, filename);
+            exit(EXIT_FAILURE);
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            char *grown = realloc(puzzles, (size_t) capacity * cells);
+            if (!grown) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+            puzzles = grown;
+        }
+        memcpy(puzzles + (size_t) count * cells, line, cells);
+        count++;
+    }
+    free(line);
+    free(board);
+    fclose(file);
+    phase_end(PHASE_PARSE, &start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // with -compact the rules depend on the clues and are encoded per puzzle
+    struct SudokuEncoder rules;
+    init_sudoku_encoder(&rules, amo_encoding, NULL);
+    if (!compact) generate_sudoku_constraints(&rules);
+    phase_end(PHASE_GENERATE, &start);
+
+    int projected;
+    int *projection = sudoku_projection(NULL, &projected);
+    struct BatchJob job = {
+        .puzzles = puzzles,
+        .solutions = malloc((size_t) count * (cells + 1)),
+        .solved = calloc(count, sizeof(char)),
+        .count = count,
+        .cells = cells,
+        .rules = rules.set,
+        .variables = rules.variables,
+        .projection = projection,
+        .projected = projected,
+        .queues = malloc(num_threads * sizeof(struct WorkQueue)),
+        .workers = num_threads,
+    };
+    struct BatchWorker *workers = malloc(num_threads * sizeof(struct BatchWorker));
+    for (int w = 0; w < num_threads; w++) {
+        pthread_mutex_init(&job.queues[w].lock, NULL);
+        job.queues[w].next = (int) ((long long) count * w / num_threads);
+        job.queues[w].end = (int) ((long long) count * (w + 1) / num_threads);
+        workers[w].job = &job;
+        workers[w].id = w;
+        memset(&workers[w].stats, 0, sizeof(workers[w].stats));
+    }
+    struct timespec solve_start;
+    phase_start(&solve_start);
+    for (int w = 0; w < num_threads; w++) {
+        pthread_create(&workers[w].thread, NULL, batch_worker, &workers[w]);
+    }
+    for (int w = 0; w < num_threads; w++) {
+        pthread_join(workers[w].thread, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    phase_end(PHASE_SOLVE, &solve_start);
+
+    int solved = 0, unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (job.solved[i]) {
+            solved++;
+            unique += job.solved[i] == 1;
+            if (unique_check) printf("%s ", job.solved[i] == 1 ? "UNIQUE" : "MULTIPLE");
+            printf("%s\n", job.solutions + (size_t) i * (cells + 1));
+        } else {
+            printf("UNSATISFIABLE\n");
+        }
+    }
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "Solved %d of %d puzzles in %.3f s on %d threads (%.1f puzzles/sec)\n",
+            solved, count, seconds, num_threads, seconds > 0 ? count / seconds : 0.0);
+    if (unique_check) {
+        fprintf(stderr, "%d unique, %d with several solutions\n", unique, solved - unique);
+    }
+
+    for (int w = 0; w < num_threads; w++) {
+        pthread_mutex_destroy(&job.queues[w].lock);
+        add_solver_stats(&run_stats, &workers[w].stats);
+    }
+    run_result = solved == count ? "SATISFIABLE" : "UNSATISFIABLE";
+    free(workers);
+    free(job.queues);
+    free(job.solved);
+    free(job.solutions);
+    free((int *) job.projection);
+    free(puzzles);
+    free_sudoku_encoder(&rules);
+}
+
+
+// Answer "what if" queries against the board given on the command line.
+// The rules and clues go into one incremental solver once; every line of
+// the file lists cell assignments, "!" in front to rule a value out, that
+// only hold for that query. Learned clauses carry over between queries.
+void solve_query_file(const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open query file '%s'\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // queries may assume any cell variable, so -compact does not apply
+    struct SudokuEncoder encoder;
+    struct timespec start, end;
+    phase_start(&start);
+    init_sudoku_encoder(&encoder, amo_encoding, NULL);
+    generate_clue_clauses(&encoder, sudoku_board);
+    generate_sudoku_constraints(&encoder);
+    solver_t *solver = create_incremental_solver(encoder.set);
+    free_sudoku_encoder(&encoder);
+    phase_end(PHASE_GENERATE, &start);
+
+    int cells = sudoku_size * sudoku_size;
+    int *assumptions = malloc(cells * sudoku_size * sizeof(int));
+    char *solution_line = malloc(cells + 1);
+    char *line = NULL;
+    size_t line_capacity = 0;
+    int line_number = 0, count = 0, result = UNSATISFIABLE;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (getline(&line, &line_capacity, file) != -1) {
+        line_number++;
+        int size = 0;
+        for (char *token = strtok(line, " \t\r\n"); token; token = strtok(NULL, " \t\r\n")) {
+            int row, col, val, negated = token[0] == '!';
+            if (token[0] == '#') break;
+            if (parse_cell_assignment(token + negated, &row, &col, &val) != 1 || size == cells * sudoku_size) {
+                fprintf(stderr, "Error: Invalid query '%s' on line %d of '%s'\n", token, line_number, filename);
+                exit(EXIT_FAILURE);
+            }
+            assumptions[size++] = negated ? -sudoku_variable(val, row, col) : sudoku_variable(val, row, col);
+        }
+        if (size == 0) continue;
+
+        result = solver_solve_assumptions(solver, assumptions, size);
+        count++;
+        if (result == SATISFIABLE) {
+            format_solution_line(solver, solution_line);
+            printf("SATISFIABLE %s\n", solution_line);
+        } else if (result == UNSATISFIABLE) {
+            // the failed core: assumptions that cannot hold together with the board
+            printf("UNSATISFIABLE");
+            for (int i = 0; i < size; i++) {
+                if (!solver_failed(solver, assumptions[i])) continue;
+                int index = abs(assumptions[i]) - 1;
+                printf(" %s%d,%d=%d", assumptions[i] < 0 ? "!" : "", (index / sudoku_size) % sudoku_size + 1,
+                       index / cells + 1, index % sudoku_size + 1);
+            }
+            printf("\n");
+        } else {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(line);
+    fclose(file);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    phase_seconds[PHASE_SOLVE] += seconds;
+    fprintf(stderr, "Answered %d queries in %.3f s (%.1f queries/sec)\n", count, seconds, seconds > 0 ? count / seconds : 0.0);
+
+    record_solver_stats(solver, result);
+    free(assumptions);
+    free(solution_line);
+    solver_destroy(solver);
+}
+
+// Create an incremental solver with the options given on the command line
+// that holds a copy of the clause set
+solver_t *create_incremental_solver(const struct ClauseSet *set) {
+    solver_t *solver = solver_create();
+    if (!solver) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    solver->verbose = verbose;
+    solver->cdcl = cdcl;
+    solver->heuristic = heuristic;
+    for (int c = 0; c < set->size; c = nextClause(set, c)) {
+        if (solver_add_clause(solver, clauseLiterals(set, c), clauseSize(set, c)) != SOLVER_OK) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return solver;
+}
+
+// The cell variables 1..sudoku_size^3, which tell sudoku solutions apart
+// whatever auxiliaries the encoding adds. With -compact only the variables
+// left open by the clues are encoded, the others are false and must not be
+// enumerated as free; open is NULL when every cell variable is encoded.
+int *sudoku_projection(const char *open, int *count) {
+    int variables = sudoku_size * sudoku_size * sudoku_size;
+    int *projection = malloc(variables * sizeof(int));
+    if (!projection) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    *count = 0;
+    for (int i = 1; i <= variables; i++) {
+        if (!open || open[i]) projection[(*count)++] = i;
+    }
+    return projection;
+}
+
+// Enumerate the solutions of the clause set, told apart by the projected
+// variables only. Every solution blocks itself and the search continues with
+// what it learned. With -unique the search stops at the second solution and
+// prints UNIQUE and the solution, MULTIPLE or UNSATISFIABLE; otherwise up to
+// max_models solutions are printed. Preprocessing is not applied, as
+// eliminated variables would be missing from the projection. Returns the
+// number of solutions found.
+int enumerate_solutions(const struct ClauseSet *set, const int *projection, int count,
+                        void (*print_model)(const solver_t *solver, void *data), void *data) {
+    solver_t *solver = create_incremental_solver(set);
+    int limit = unique_check ? 2 : max_models;
+    struct timespec start;
+    phase_start(&start);
+    int found = solver_enumerate(solver, projection, count, limit, unique_check ? NULL : print_model, data);
+    phase_end(PHASE_SOLVE, &start);
+    if (found == SOLVER_ERROR) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (unique_check) {
+        printf("%s\n", found == 0 ? "UNSATISFIABLE" : found == 1 ? "UNIQUE" : "MULTIPLE");
+        if (found == 1) print_model(solver, data);
+    } else {
+        printf("Found %d solution%s%s\n", found, found == 1 ? "" : "s", found == limit ? " (limit reached)" : "");
+    }
+    record_solver_stats(solver, found > 0 ? SATISFIABLE : UNSATISFIABLE);
+    solver_destroy(solver);
+    return found;
+}
+
+// Print a sudoku solution as one line in the puzzle file format; data is a
+// buffer of sudoku_size^2 + 1 characters
+void print_sudoku_model(const solver_t *solver, void *data) {
+    format_solution_line(solver, data);
+    printf("%s\n", (char *) data);
+}
+
+// Print the named variables of a BNF solution; data is the symbol table
+void print_bnf_model(const solver_t *solver, void *data) {
+    writeSolutionToOutput((struct Solver *) solver, 1, data);
+}
+
+// Write the clause set to dump_file in DIMACS format, "-" for standard output
+void dump_dimacs(const struct ClauseSet *set, int variables) {
+    FILE *out = strcmp(dump_file, "-") == 0 ? stdout : fopen(dump_file, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not open DIMACS output file '%s'\n", dump_file);
+        exit(EXIT_FAILURE);
+    }
+    int result = writeDimacs(out, set, variables);
+    if ((out == stdout ? fflush(out) : fclose(out)) != 0 || result != SOLVER_OK) {
+        fprintf(stderr, "Error: Could not write DIMACS output file '%s'\n", dump_file);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Solve a DIMACS CNF file and print the result in the SAT competition
+// format: an "s" status line followed by "v" lines holding the model
+void solve_dimacs_file(const char *filename) {
+    struct ClauseSet *set = createClauseSet();
+    int variables, declared_clauses, error_line;
+
+    if (!set) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    struct timespec start;
+    phase_start(&start);
+    int status = readDimacsFile(filename, set, &variables, &declared_clauses, &error_line);
+    phase_end(PHASE_PARSE, &start);
+    if (status != SOLVER_OK) {
+        if (error_line > 0) {
+            fprintf(stderr, "Error: Invalid DIMACS input in '%s' at line %d\n", filename, error_line);
+        } else {
+            fprintf(stderr, "Error: Could not read DIMACS file '%s': %s\n", filename, strerror(errno));
+        }
+        exit(EXIT_FAILURE);
+    }
+    if (set->count != declared_clauses) {
+        fprintf(stderr, "Warning: '%s' declares %d clauses but contains %d\n", filename, declared_clauses, set->count);
+    }
+    if (verbose) {
+        printf("Read %d variables and %d clauses from '%s'\n", variables, set->count, filename);
+    }
+    if (dump_file) {
+        dump_dimacs(set, variables);
+    }
+
+    struct Solver *solver = create_configured_solver(variables);
+    phase_start(&start);
+    int result = solve_clause_set(solver, set);
+    phase_end(PHASE_SOLVE, &start);
+    if (result == SATISFIABLE) {
+        printf("s SATISFIABLE\n");
+        for (int i = 1; i <= variables; i++) {
+            // variables that occur in no clause may take either value
+            int literal = solver->valuation[i] == 1 ? i : -i;
+            printf("%s%d", (i - 1) % 20 == 0 ? "v " : " ", literal);
+            if (i % 20 == 0) printf("\n");
+        }
+        printf("%s0\n", variables % 20 == 0 ? "v " : " ");
+    } else if (result == UNSATISFIABLE) {
+        printf("s UNSATISFIABLE\n");
+    } else {
+        printf("s UNKNOWN\n");
+    }
+    record_solver_stats(solver, result);
+    freeSolver(solver);
+    freeClauseSet(set);
+}
+
+// Start timing a phase. Like the solver counters, the phase timers are
+// compiled out when DPLL_STATS is 0.
+void phase_start(struct timespec *start) {
+#if DPLL_STATS
+    clock_gettime(CLOCK_MONOTONIC, start);
+#else
+    (void) start;
+#endif
+}
+
+// Add the time since start to a phase
+void phase_end(int phase, const struct timespec *start) {
+#if DPLL_STATS
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    phase_seconds[phase] += (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+#else
+    (void) phase;
+    (void) start;
+#endif
+}
+
+// Sum the counters of stats into total; the depth is the largest of both
+void add_solver_stats(struct SolverStats *total, const struct SolverStats *stats) {
+    total->decisions += stats->decisions;
+    total->propagations += stats->propagations;
+    total->conflicts += stats->conflicts;
+    total->backtracks += stats->backtracks;
+    total->learnedClauses += stats->learnedClauses;
+    if (stats->maxDepth > total->maxDepth) total->maxDepth = stats->maxDepth;
+}
+
+// Add the counters of a solver to the run statistics
+void record_solver_stats(const struct Solver *solver, int result) {
+    add_solver_stats(&run_stats, &solver->stats);
+    run_result = result == SATISFIABLE ? "SATISFIABLE" : result == UNSATISFIABLE ? "UNSATISFIABLE" : "UNKNOWN";
+}
+
+// Write the run statistics to stats_file as one JSON object, or as a CSV
+// header and row with the same fields
+void write_stats() {
+    FILE *out = strcmp(stats_file, "-") == 0 ? stdout : fopen(stats_file, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not open statistics file '%s'\n", stats_file);
+        exit(EXIT_FAILURE);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    const char *names[] = {"result", "decisions", "propagations", "conflicts", "backtracks", "max_depth",
+                           "learned_clauses", "peak_rss_kb"};
+    char values[8][32];
+    snprintf(values[0], sizeof(values[0]), "%s", run_result);
+    snprintf(values[1], sizeof(values[1]), "%lld", run_stats.decisions);
+    snprintf(values[2], sizeof(values[2]), "%lld", run_stats.propagations);
+    snprintf(values[3], sizeof(values[3]), "%lld", run_stats.conflicts);
+    snprintf(values[4], sizeof(values[4]), "%lld", run_stats.backtracks);
+    snprintf(values[5], sizeof(values[5]), "%d", run_stats.maxDepth);
+    snprintf(values[6], sizeof(values[6]), "%lld", run_stats.learnedClauses);
+    snprintf(values[7], sizeof(values[7]), "%ld", usage.ru_maxrss);  // kilobytes on Linux
+
+    if (stats_csv) {
+        for (int i = 0; i < 8; i++) fprintf(out, "%s,", names[i]);
+        for (int phase = 0; phase < PHASES; phase++) fprintf(out, "%s_seconds%s", phase_names[phase], phase + 1 < PHASES ? "," : "\n");
+        for (int i = 0; i < 8; i++) fprintf(out, "%s,", values[i]);
+        for (int phase = 0; phase < PHASES; phase++) fprintf(out, "%.6f%s", phase_seconds[phase], phase + 1 < PHASES ? "," : "\n");
+    } else {
+        fprintf(out, "{\"%s\": \"%s\"", names[0], values[0]);
+        for (int i = 1; i < 8; i++) fprintf(out, ", \"%s\": %s", names[i], values[i]);
+        for (int phase = 0; phase < PHASES; phase++) fprintf(out, ", \"%s_seconds\": %.6f", phase_names[phase], phase_seconds[phase]);
+        fprintf(out, "}\n");
+    }
+    if ((out == stdout ? fflush(out) : fclose(out)) != 0) {
+        fprintf(stderr, "Error: Could not write statistics file '%s'\n", stats_file);
+        exit(EXIT_FAILURE);
+    }
+}
 
 int main(int argc, char *argv[]) {
     parse_arguments(argc, argv);
 
-    if (bnf_file) {
+    if (dimacs_file) {
+        solve_dimacs_file(dimacs_file);
+    } else if (batch_file) {
+        solve_batch_file(batch_file);
+    } else if (query_file) {
+        solve_query_file(query_file);
+    } else if (bnf_file) {
         parse_bnf_file(bnf_file);
     } else {
         if (verbose) {
@@ -433,11 +1548,17 @@ int main(int argc, char *argv[]) {
         if (bnf == 1){
             parse_bnf_file(bnf_file);
 
+        }else if (compare_encodings){
+            compare_sudoku_encodings();
         }else{
             generate_cnf_clauses();
         }
     }
 
+    if (stats_file) {
+        write_stats();
+    }
+
     return 0;
 }
 
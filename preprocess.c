@@ -0,0 +1,568 @@
+#include "preprocess.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROBE_BUDGET 50             // clause visits allowed per input literal while probing
+#define ELIMINATION_OCCURRENCES 16  // skip variables with more clauses in both polarities
+#define RESOLVENT_LIMIT 32          // longest resolvent bounded variable elimination may add
+
+// Clauses of one literal; entries of removed clauses are dropped lazily
+struct Occurrences {
+    int * clauses;
+    int size;
+    int capacity;
+};
+
+// Working copy of the clause set with occurrence lists
+struct Simplifier {
+    struct Preprocessor * p;
+    int ** literals;   // per clause, sorted by variable
+    int * sizes;
+    char * removed;
+    int clauseCount;
+    int clauseCapacity;
+    struct Occurrences * occurrences;  // indexed by literalIndex()
+    int * queue;       // literals fixed at the top level, in assignment order
+    int queueSize;
+    int queueHead;
+    char * marks;      // per literal index, scratch for subset tests
+    signed char * probeValue;  // per variable: -1 or the value assumed by the running probe
+    int * resolvent;
+    int unsatisfiable;
+};
+
+static int literalIndex(int literal) {
+    return 2 * abs(literal) + (literal < 0);
+}
+
+static double elapsedSeconds(const struct timespec * start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// grows an array to hold needed elements; returns -1 when out of memory
+static int reserve(void ** array, int * capacity, int needed, size_t elementSize) {
+    if (needed <= *capacity) return 0;
+    int grown = *capacity ? *capacity : 8;
+    while (grown < needed) grown *= 2;
+    void * memory = realloc(*array, grown * elementSize);
+    if (memory == NULL) return -1;
+    *array = memory;
+    *capacity = grown;
+    return 0;
+}
+
+static int compareLiterals(const void * a, const void * b) {
+    int x = *(const int *) a, y = *(const int *) b;
+    if (abs(x) != abs(y)) return abs(x) < abs(y) ? -1 : 1;
+    return (x > y) - (x < y);
+}
+
+static int literalValue(const struct Simplifier * s, int literal) {
+    int value = s->p->value[abs(literal)];
+    return value == -1 ? -1 : (literal > 0) == value;
+}
+
+// fixes literal at the top level and queues it for propagation
+static void assign(struct Simplifier * s, int literal) {
+    int value = literalValue(s, literal);
+    if (value == 0) s->unsatisfiable = 1;
+    if (value != -1) return;
+    s->p->value[abs(literal)] = literal > 0;
+    s->queue[s->queueSize++] = literal;
+    s->p->stats.fixedVariables++;
+}
+
+static int addOccurrence(struct Simplifier * s, int literal, int clause) {
+    struct Occurrences * list = &s->occurrences[literalIndex(literal)];
+    if (reserve((void **) &list->clauses, &list->capacity, list->size + 1, sizeof(int)) == -1) return SOLVER_ERROR;
+    list->clauses[list->size++] = clause;
+    return SOLVER_OK;
+}
+
+// live clauses containing literal, dropping stale entries on the way
+static int countOccurrences(struct Simplifier * s, int literal) {
+    struct Occurrences * list = &s->occurrences[literalIndex(literal)];
+    int kept = 0;
+    for (int i = 0; i < list->size; i++) {
+        if (!s->removed[list->clauses[i]]) list->clauses[kept++] = list->clauses[i];
+    }
+    list->size = kept;
+    return kept;
+}
+
+// Adds a clause after dropping false and repeated literals. Satisfied
+// clauses and tautologies are skipped and units are assigned instead of
+// stored. literals is reordered in place.
+static int addSimplifierClause(struct Simplifier * s, int * literals, int size) {
+    qsort(literals, size, sizeof(int), compareLiterals);
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        int value = literalValue(s, literals[i]);
+        if (value == 1) return SOLVER_OK;
+        if (value == 0 || (kept > 0 && literals[kept - 1] == literals[i])) continue;
+        if (kept > 0 && literals[kept - 1] == -literals[i]) return SOLVER_OK;
+        literals[kept++] = literals[i];
+    }
+    if (kept == 0) {
+        s->unsatisfiable = 1;
+        return SOLVER_OK;
+    }
+    if (kept == 1) {
+        assign(s, literals[0]);
+        return SOLVER_OK;
+    }
+
+    int clause = s->clauseCount;
+    if (clause == s->clauseCapacity) {
+        int capacity = s->clauseCapacity ? 2 * s->clauseCapacity : 1024;
+        int ** literalArrays = realloc(s->literals, capacity * sizeof(int *));
+        if (literalArrays == NULL) return SOLVER_ERROR;
+        s->literals = literalArrays;
+        int * sizes = realloc(s->sizes, capacity * sizeof(int));
+        if (sizes == NULL) return SOLVER_ERROR;
+        s->sizes = sizes;
+        char * removed = realloc(s->removed, capacity);
+        if (removed == NULL) return SOLVER_ERROR;
+        s->removed = removed;
+        s->clauseCapacity = capacity;
+    }
+
+    s->literals[clause] = malloc(kept * sizeof(int));
+    if (s->literals[clause] == NULL) return SOLVER_ERROR;
+    memcpy(s->literals[clause], literals, kept * sizeof(int));
+    s->sizes[clause] = kept;
+    s->removed[clause] = 0;
+    s->clauseCount++;
+    for (int i = 0; i < kept; i++) {
+        if (addOccurrence(s, literals[i], clause) != SOLVER_OK) return SOLVER_ERROR;
+    }
+    return SOLVER_OK;
+}
+
+// deletes literal from a clause, fixing the last one left
+static void removeLiteral(struct Simplifier * s, int clause, int literal) {
+    int * literals = s->literals[clause];
+    int size = s->sizes[clause], i = 0;
+    while (i < size && literals[i] != literal) i++;
+    if (i == size) return;
+    memmove(literals + i, literals + i + 1, (size - i - 1) * sizeof(int));
+    s->sizes[clause] = --size;
+    if (size == 1) {
+        assign(s, literals[0]);
+        s->removed[clause] = 1;
+    }
+}
+
+// applies the queued top-level assignments to the clauses
+static void propagate(struct Simplifier * s) {
+    while (s->queueHead < s->queueSize && !s->unsatisfiable) {
+        int literal = s->queue[s->queueHead++];
+        struct Occurrences * satisfied = &s->occurrences[literalIndex(literal)];
+        for (int i = 0; i < satisfied->size; i++) s->removed[satisfied->clauses[i]] = 1;
+        satisfied->size = 0;
+
+        struct Occurrences * falsified = &s->occurrences[literalIndex(-literal)];
+        for (int i = 0; i < falsified->size; i++) {
+            if (!s->removed[falsified->clauses[i]]) removeLiteral(s, falsified->clauses[i], -literal);
+        }
+        falsified->size = 0;
+    }
+}
+
+// Assumes literal and propagates it without touching the clauses; returns 1
+// when that leads to a conflict, so the negation of literal is implied
+static int probe(struct Simplifier * s, int literal, long * budget) {
+    int * trail = s->resolvent + RESOLVENT_LIMIT;  // scratch space of variableNumber entries
+    int trailSize = 0, conflict = 0;
+    trail[trailSize++] = literal;
+    s->probeValue[abs(literal)] = literal > 0;
+
+    for (int head = 0; head < trailSize && !conflict && *budget > 0; head++) {
+        struct Occurrences * list = &s->occurrences[literalIndex(-trail[head])];
+        for (int i = 0; i < list->size && !conflict; i++) {
+            int clause = list->clauses[i];
+            if (s->removed[clause]) continue;
+            (*budget)--;
+
+            int open = 0, unit = 0, satisfied = 0;
+            for (int j = 0; j < s->sizes[clause] && !satisfied; j++) {
+                int other = s->literals[clause][j];
+                int value = s->probeValue[abs(other)];
+                if (value == -1) {
+                    open++;
+                    unit = other;
+                } else if ((other > 0) == value) {
+                    satisfied = 1;
+                }
+            }
+            if (satisfied || open > 1) continue;
+            if (open == 0) conflict = 1;
+            else {
+                trail[trailSize++] = unit;
+                s->probeValue[abs(unit)] = unit > 0;
+            }
+        }
+    }
+
+    for (int i = 0; i < trailSize; i++) s->probeValue[abs(trail[i])] = -1;
+    return conflict;
+}
+
+// Failed literal probing: every literal whose assumption propagates to a
+// conflict is fixed to false at the top level
+static void probeLiterals(struct Simplifier * s, long budget) {
+    for (int variable = 1; variable <= s->p->variableNumber && !s->unsatisfiable && budget > 0; variable++) {
+        for (int sign = 1; sign >= -1; sign -= 2) {
+            int literal = sign * variable;
+            if (s->p->value[variable] != -1 || s->p->eliminated[variable]) break;
+            if (s->occurrences[literalIndex(-literal)].size == 0) continue;
+            if (probe(s, literal, &budget)) {
+                s->p->stats.failedLiterals++;
+                assign(s, -literal);
+                propagate(s);
+            }
+        }
+    }
+}
+
+// Live clauses ordered from short to long (counting sort), so that
+// subsuming clauses come first
+static int * clausesBySize(struct Simplifier * s, int * count) {
+    int longest = 0;
+    for (int clause = 0; clause < s->clauseCount; clause++) {
+        if (!s->removed[clause] && s->sizes[clause] > longest) longest = s->sizes[clause];
+    }
+    int * order = malloc((s->clauseCount > 0 ? s->clauseCount : 1) * sizeof(int));
+    int * starts = calloc(longest + 2, sizeof(int));
+    if (order == NULL || starts == NULL) {
+        free(order);
+        free(starts);
+        return NULL;
+    }
+    for (int clause = 0; clause < s->clauseCount; clause++) {
+        if (!s->removed[clause]) starts[s->sizes[clause] + 1]++;
+    }
+    for (int size = 1; size <= longest + 1; size++) starts[size] += starts[size - 1];
+    *count = starts[longest + 1];
+    for (int clause = 0; clause < s->clauseCount; clause++) {
+        if (!s->removed[clause]) order[starts[s->sizes[clause]]++] = clause;
+    }
+    free(starts);
+    return order;
+}
+
+// number of literals of other that are marked
+static int countMarked(const struct Simplifier * s, int other) {
+    int matches = 0;
+    for (int j = 0; j < s->sizes[other]; j++) matches += s->marks[literalIndex(s->literals[other][j])];
+    return matches;
+}
+
+static void markClause(struct Simplifier * s, int clause, char mark) {
+    for (int i = 0; i < s->sizes[clause]; i++) s->marks[literalIndex(s->literals[clause][i])] = mark;
+}
+
+// Removes every clause that contains all literals of a shorter or equal clause
+static int subsume(struct Simplifier * s) {
+    int count;
+    int * order = clausesBySize(s, &count);
+    if (order == NULL) return SOLVER_ERROR;
+
+    for (int k = 0; k < count; k++) {
+        int clause = order[k];
+        if (s->removed[clause]) continue;
+
+        // candidates share the literal with the fewest occurrences
+        int best = s->literals[clause][0];
+        for (int i = 1; i < s->sizes[clause]; i++) {
+            int literal = s->literals[clause][i];
+            if (s->occurrences[literalIndex(literal)].size < s->occurrences[literalIndex(best)].size) best = literal;
+        }
+
+        markClause(s, clause, 1);
+        struct Occurrences * list = &s->occurrences[literalIndex(best)];
+        for (int i = 0; i < list->size; i++) {
+            int other = list->clauses[i];
+            if (other == clause || s->removed[other] || s->sizes[other] < s->sizes[clause]) continue;
+            if (countMarked(s, other) == s->sizes[clause]) {
+                s->removed[other] = 1;
+                s->p->stats.subsumedClauses++;
+            }
+        }
+        markClause(s, clause, 0);
+    }
+    free(order);
+    return SOLVER_OK;
+}
+
+// Self-subsuming resolution: when a clause C v l and a clause D v !l with
+// C contained in D exist, their resolvent D subsumes D v !l, so !l is dropped
+static int strengthen(struct Simplifier * s) {
+    int count;
+    int * order = clausesBySize(s, &count);
+    if (order == NULL) return SOLVER_ERROR;
+
+    for (int k = 0; k < count && !s->unsatisfiable; k++) {
+        int clause = order[k];
+        if (s->removed[clause]) continue;
+
+        markClause(s, clause, 1);
+        for (int i = 0; i < s->sizes[clause] && !s->removed[clause]; i++) {
+            int literal = s->literals[clause][i];
+            struct Occurrences * list = &s->occurrences[literalIndex(-literal)];
+            for (int j = 0; j < list->size;) {
+                int other = list->clauses[j];
+                if (s->removed[other] || s->sizes[other] < s->sizes[clause] ||
+                    countMarked(s, other) != s->sizes[clause] - 1) {
+                    j++;
+                    continue;
+                }
+                removeLiteral(s, other, -literal);
+                list->clauses[j] = list->clauses[--list->size];
+                s->p->stats.strengthenedClauses++;
+            }
+        }
+        markClause(s, clause, 0);
+        propagate(s);
+    }
+    free(order);
+    return SOLVER_OK;
+}
+
+#define TAUTOLOGY (-1)
+#define TOO_LONG (-2)
+
+// Resolves two clauses on their clashing variable into s->resolvent; returns
+// the resolvent size, TAUTOLOGY or TOO_LONG
+static int resolve(struct Simplifier * s, int positive, int negative, int variable) {
+    int size = 0, result = 0;
+    for (int i = 0; i < s->sizes[positive]; i++) {
+        int literal = s->literals[positive][i];
+        if (abs(literal) == variable) continue;
+        s->marks[literalIndex(literal)] = 1;
+        s->resolvent[size++] = literal;
+    }
+    for (int i = 0; i < s->sizes[negative] && result == 0; i++) {
+        int literal = s->literals[negative][i];
+        if (abs(literal) == variable || s->marks[literalIndex(literal)]) continue;
+        if (s->marks[literalIndex(-literal)]) result = TAUTOLOGY;
+        else if (size == RESOLVENT_LIMIT) result = TOO_LONG;
+        else s->resolvent[size++] = literal;
+    }
+    for (int i = 0; i < s->sizes[positive]; i++) s->marks[literalIndex(s->literals[positive][i])] = 0;
+    return result < 0 ? result : size;
+}
+
+// stores a clause with its pivot on the reconstruction stack
+static int pushReconstruction(struct Preprocessor * p, const int * literals, int size, int pivot) {
+    if (reserve((void **) &p->stack, &p->stackCapacity, p->stackSize + size + 2, sizeof(int)) == -1) return SOLVER_ERROR;
+    memcpy(p->stack + p->stackSize, literals, size * sizeof(int));
+    p->stackSize += size;
+    p->stack[p->stackSize++] = size;
+    p->stack[p->stackSize++] = pivot;
+    return SOLVER_OK;
+}
+
+// Eliminates variable by resolution if that does not add clauses
+static int eliminate(struct Simplifier * s, int variable, int * positives, int * negatives) {
+    int positiveCount = countOccurrences(s, variable), negativeCount = countOccurrences(s, -variable);
+    if (positiveCount > ELIMINATION_OCCURRENCES && negativeCount > ELIMINATION_OCCURRENCES) return SOLVER_OK;
+    memcpy(positives, s->occurrences[literalIndex(variable)].clauses, positiveCount * sizeof(int));
+    memcpy(negatives, s->occurrences[literalIndex(-variable)].clauses, negativeCount * sizeof(int));
+
+    int resolvents = 0;
+    for (int i = 0; i < positiveCount; i++) {
+        for (int j = 0; j < negativeCount; j++) {
+            int size = resolve(s, positives[i], negatives[j], variable);
+            if (size == TOO_LONG) return SOLVER_OK;
+            if (size != TAUTOLOGY && ++resolvents > positiveCount + negativeCount) return SOLVER_OK;
+        }
+    }
+
+    // the model is rebuilt from the positive clauses: variable defaults to
+    // false and becomes true when one of them is not satisfied otherwise
+    for (int i = 0; i < positiveCount; i++) {
+        if (pushReconstruction(s->p, s->literals[positives[i]], s->sizes[positives[i]], variable) != SOLVER_OK) return SOLVER_ERROR;
+    }
+    if (pushReconstruction(s->p, NULL, 0, -variable) != SOLVER_OK) return SOLVER_ERROR;
+
+    for (int i = 0; i < positiveCount; i++) {
+        for (int j = 0; j < negativeCount; j++) {
+            int size = resolve(s, positives[i], negatives[j], variable);
+            if (size >= 0 && addSimplifierClause(s, s->resolvent, size) != SOLVER_OK) return SOLVER_ERROR;
+        }
+    }
+    for (int i = 0; i < positiveCount; i++) s->removed[positives[i]] = 1;
+    for (int i = 0; i < negativeCount; i++) s->removed[negatives[i]] = 1;
+    s->occurrences[literalIndex(variable)].size = 0;
+    s->occurrences[literalIndex(-variable)].size = 0;
+    s->p->eliminated[variable] = 1;
+    s->p->stats.eliminatedVariables++;
+    propagate(s);
+    return SOLVER_OK;
+}
+
+static int compareCandidates(const void * a, const void * b) {
+    long long x = *(const long long *) a, y = *(const long long *) b;
+    return (x > y) - (x < y);
+}
+
+// Bounded variable elimination, trying variables with few occurrences first
+static int eliminateVariables(struct Simplifier * s) {
+    int n = s->p->variableNumber, count = 0, result = SOLVER_OK;
+    int positiveCapacity = 0, negativeCapacity = 0;
+    long long * candidates = malloc((n + 1) * sizeof(long long));  // occurrence count << 32 | variable
+    int * positives = NULL, * negatives = NULL;
+    if (candidates == NULL) return SOLVER_ERROR;
+
+    for (int variable = 1; variable <= n; variable++) {
+        int occurrences = countOccurrences(s, variable) + countOccurrences(s, -variable);
+        if (s->p->value[variable] == -1 && occurrences > 0) candidates[count++] = (long long) occurrences << 32 | variable;
+    }
+    qsort(candidates, count, sizeof(long long), compareCandidates);
+
+    for (int i = 0; i < count && result == SOLVER_OK && !s->unsatisfiable; i++) {
+        int variable = (int) (candidates[i] & 0xffffffff);
+        if (s->p->value[variable] != -1) continue;
+        // resolvents added so far may occur too, so size the buffers per variable
+        if (reserve((void **) &positives, &positiveCapacity, s->clauseCount, sizeof(int)) == -1 ||
+            reserve((void **) &negatives, &negativeCapacity, s->clauseCount, sizeof(int)) == -1) {
+            result = SOLVER_ERROR;
+            break;
+        }
+        result = eliminate(s, variable, positives, negatives);
+    }
+
+    free(candidates);
+    free(positives);
+    free(negatives);
+    return result;
+}
+
+static void freeSimplifier(struct Simplifier * s) {
+    for (int i = 0; i < s->clauseCount; i++) free(s->literals[i]);
+    free(s->literals);
+    free(s->sizes);
+    free(s->removed);
+    if (s->occurrences != NULL) {
+        for (int i = 0; i < 2 * (s->p->variableNumber + 1); i++) free(s->occurrences[i].clauses);
+    }
+    free(s->occurrences);
+    free(s->queue);
+    free(s->marks);
+    free(s->probeValue);
+    free(s->resolvent);
+}
+
+struct Preprocessor * createPreprocessor(int numVariables) {
+    struct Preprocessor * p = calloc(1, sizeof(struct Preprocessor));
+    if (p == NULL) return NULL;
+    p->variableNumber = numVariables;
+    p->value = malloc((numVariables + 1) * sizeof(int));
+    p->eliminated = calloc(numVariables + 1, 1);
+    p->occurred = calloc(numVariables + 1, 1);
+    if (p->value == NULL || p->eliminated == NULL || p->occurred == NULL) {
+        freePreprocessor(p);
+        return NULL;
+    }
+    for (int i = 0; i <= numVariables; i++) p->value[i] = -1;
+    return p;
+}
+
+int preprocess(struct Preprocessor * p, struct ClauseSet * set) {
+    struct Simplifier s = { .p = p };
+    int n = p->variableNumber, result = SOLVER_OK;
+    struct timespec start;
+
+    s.occurrences = calloc(2 * (n + 1), sizeof(struct Occurrences));
+    s.queue = malloc((n + 1) * sizeof(int));
+    s.marks = calloc(2 * (n + 1), 1);
+    s.probeValue = malloc(n + 1);
+    s.resolvent = malloc((RESOLVENT_LIMIT + n + 1) * sizeof(int));
+    if (s.occurrences == NULL || s.queue == NULL || s.marks == NULL || s.probeValue == NULL || s.resolvent == NULL) {
+        freeSimplifier(&s);
+        return SOLVER_ERROR;
+    }
+    memset(s.probeValue, -1, n + 1);
+
+    // load the problem clauses, propagating units on the way
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long literalCount = 0;
+    p->stats.clausesBefore = 0;
+    for (int clause = 0; clause < set->size && result == SOLVER_OK; clause = nextClause(set, clause)) {
+        if (clauseFlags(set, clause) & CLAUSE_LEARNT) continue;
+        int * literals = clauseLiterals(set, clause);
+        int size = clauseSize(set, clause);
+        for (int i = 0; i < size; i++) {
+            if (literals[i] == 0 || abs(literals[i]) > n) result = SOLVER_ERROR;
+            else p->occurred[abs(literals[i])] = 1;
+        }
+        p->stats.clausesBefore++;
+        literalCount += size;
+        if (result == SOLVER_OK) result = addSimplifierClause(&s, literals, size);
+    }
+    if (result == SOLVER_OK) {
+        propagate(&s);
+        probeLiterals(&s, PROBE_BUDGET * literalCount + 1000);
+    }
+    p->stats.probingSeconds = elapsedSeconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (result == SOLVER_OK && !s.unsatisfiable) result = subsume(&s);
+    p->stats.subsumptionSeconds = elapsedSeconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (result == SOLVER_OK && !s.unsatisfiable) result = strengthen(&s);
+    p->stats.strengtheningSeconds = elapsedSeconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (result == SOLVER_OK && !s.unsatisfiable) result = eliminateVariables(&s);
+    p->stats.eliminationSeconds = elapsedSeconds(&start);
+
+    // write the surviving clauses back in their original order
+    if (result == SOLVER_OK) {
+        truncateClauseSet(set, 0, 0);
+        if (s.unsatisfiable) {
+            if (addClause(set, NULL, 0, 0) == -1) result = SOLVER_ERROR;
+        } else {
+            for (int clause = 0; clause < s.clauseCount && result == SOLVER_OK; clause++) {
+                if (!s.removed[clause] && addClause(set, s.literals[clause], s.sizes[clause], 0) == -1) result = SOLVER_ERROR;
+            }
+        }
+        p->stats.clausesAfter = set->count;
+    }
+    freeSimplifier(&s);
+    if (result == SOLVER_OK && s.unsatisfiable) return UNSATISFIABLE;
+    return result;
+}
+
+void reconstructModel(const struct Preprocessor * p, int * valuation) {
+    // fixed variables first, variables dropped with their clauses default to false
+    for (int i = 1; i <= p->variableNumber; i++) {
+        if (p->value[i] != -1) valuation[i] = p->value[i];
+        else if (p->occurred[i] && !p->eliminated[i] && valuation[i] == -1) valuation[i] = 0;
+    }
+
+    // undo eliminations last to first
+    for (int top = p->stackSize; top > 0;) {
+        int pivot = p->stack[top - 1];
+        int size = p->stack[top - 2];
+        const int * literals = p->stack + top - 2 - size;
+        int satisfied = 0;
+        for (int i = 0; i < size && !satisfied; i++) satisfied = valuation[abs(literals[i])] == (literals[i] > 0);
+        if (!satisfied) valuation[abs(pivot)] = pivot > 0;
+        top -= size + 2;
+    }
+}
+
+void freePreprocessor(struct Preprocessor * p) {
+    if (p == NULL) return;
+    free(p->value);
+    free(p->eliminated);
+    free(p->occurred);
+    free(p->stack);
+    free(p);
+}
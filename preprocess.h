@@ -0,0 +1,48 @@
+#ifndef SUDOKU_PREPROCESS_H
+#define SUDOKU_PREPROCESS_H
+
+#include "dpll_solver.h"
+
+// CNF preprocessing run before search: unit propagation with failed literal
+// probing, subsumption, self-subsuming strengthening and bounded variable
+// elimination. The clause set is rewritten in place into an equisatisfiable
+// one; reconstructModel() turns a model of the result into a model of the
+// original clauses. Like the solver, it reports errors through return codes.
+
+struct PreprocessStats {
+    int clausesBefore;
+    int clausesAfter;
+    int fixedVariables;       // variables fixed by unit propagation and probing
+    int failedLiterals;       // probes that ran into a conflict
+    int subsumedClauses;
+    int strengthenedClauses;  // clauses that lost a literal to self-subsuming resolution
+    int eliminatedVariables;
+    double probingSeconds;
+    double subsumptionSeconds;
+    double strengtheningSeconds;
+    double eliminationSeconds;
+};
+
+struct Preprocessor {
+    int variableNumber;
+    int * value;        // per variable: -1 free, else the value fixed at the top level
+    char * eliminated;  // variables removed by elimination
+    char * occurred;    // variables of the input clauses
+    // Reconstruction stack of entries [literals][size][pivot]: when the clause
+    // is false under the model, the pivot literal is made true
+    int * stack;
+    int stackSize;
+    int stackCapacity;
+    struct PreprocessStats stats;
+};
+
+struct Preprocessor * createPreprocessor(int numVariables);  // NULL when out of memory
+// Simplifies set, whose literals must lie in 1..numVariables. Returns
+// SOLVER_OK, UNSATISFIABLE when a contradiction was derived (set then holds
+// the empty clause) or SOLVER_ERROR when memory runs out.
+int preprocess(struct Preprocessor * preprocessor, struct ClauseSet * set);
+// Completes a model of the simplified clauses (1, 0 or -1 per variable) in place
+void reconstructModel(const struct Preprocessor * preprocessor, int * valuation);
+void freePreprocessor(struct Preprocessor * preprocessor);
+
+#endif //SUDOKU_PREPROCESS_H
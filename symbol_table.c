@@ -0,0 +1,108 @@
+#include "symbol_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void * allocateOrDie(void * pointer, size_t size) {
+    pointer = realloc(pointer, size);
+    if (!pointer) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return pointer;
+}
+
+// FNV-1a hash of the first length characters of name
+static unsigned int hashName(const char * name, int length) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// returns the slot holding name, or the empty slot where it belongs
+static int findSlot(const struct SymbolTable * table, const char * name, int length) {
+    int mask = table->slotCount - 1;
+    int slot = hashName(name, length) & mask;
+    while (table->slots[slot] != 0) {
+        const char * candidate = table->names + table->offsets[table->slots[slot]];
+        if (strncmp(candidate, name, length) == 0 && candidate[length] == '\0') break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// doubles the hash table and reinserts every index
+static void growSlots(struct SymbolTable * table) {
+    free(table->slots);
+    table->slotCount *= 2;
+    table->slots = calloc(table->slotCount, sizeof(int));
+    if (!table->slots) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int index = 1; index <= table->count; index++) {
+        const char * name = table->names + table->offsets[index];
+        table->slots[findSlot(table, name, strlen(name))] = index;
+    }
+}
+
+struct SymbolTable * createSymbolTable() {
+    struct SymbolTable * table = allocateOrDie(NULL, sizeof(struct SymbolTable));
+    table->namesCapacity = 1024;
+    table->names = allocateOrDie(NULL, table->namesCapacity);
+    table->namesSize = 0;
+    table->offsetsCapacity = 64;
+    table->offsets = allocateOrDie(NULL, table->offsetsCapacity * sizeof(int));
+    table->count = 0;
+    table->slotCount = 128;
+    table->slots = calloc(table->slotCount, sizeof(int));
+    if (!table->slots) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return table;
+}
+
+int internSymbol(struct SymbolTable * table, const char * name, int length) {
+    int slot = findSlot(table, name, length);
+    if (table->slots[slot] != 0) return table->slots[slot];
+
+    // copy the name into the pool
+    if (table->namesSize + length + 1 > table->namesCapacity) {
+        while (table->namesSize + length + 1 > table->namesCapacity) table->namesCapacity *= 2;
+        table->names = allocateOrDie(table->names, table->namesCapacity);
+    }
+    memcpy(table->names + table->namesSize, name, length);
+    table->names[table->namesSize + length] = '\0';
+
+    if (table->count + 1 >= table->offsetsCapacity) {
+        table->offsetsCapacity *= 2;
+        table->offsets = allocateOrDie(table->offsets, table->offsetsCapacity * sizeof(int));
+    }
+    int index = ++table->count;
+    table->offsets[index] = table->namesSize;
+    table->namesSize += length + 1;
+    table->slots[slot] = index;
+
+    if (2 * table->count > table->slotCount) growSlots(table);
+    return index;
+}
+
+int findSymbol(const struct SymbolTable * table, const char * name, int length) {
+    return table->slots[findSlot(table, name, length)];
+}
+
+const char * symbolName(const struct SymbolTable * table, int index) {
+    return table->names + table->offsets[index];
+}
+
+void freeSymbolTable(struct SymbolTable * table) {
+    if (!table) return;
+    free(table->names);
+    free(table->offsets);
+    free(table->slots);
+    free(table);
+}
@@ -0,0 +1,24 @@
+#ifndef SUDOKU_SYMBOL_TABLE_H
+#define SUDOKU_SYMBOL_TABLE_H
+
+// Interns variable names of any length to dense variable indices 1..count.
+// Names are kept back to back in one character pool and found through an
+// open addressing hash table of indices.
+struct SymbolTable {
+    char * names;       // NUL-terminated names back to back
+    int namesSize;
+    int namesCapacity;
+    int * offsets;      // offsets[index]: position of the name of variable index in names
+    int count;          // number of interned names, also the highest index
+    int offsetsCapacity;
+    int * slots;        // hash slots holding variable indices, 0 when empty
+    int slotCount;      // power of two, at least twice count
+};
+
+struct SymbolTable * createSymbolTable();
+int internSymbol(struct SymbolTable * table, const char * name, int length);  // index of name, adding it if new
+int findSymbol(const struct SymbolTable * table, const char * name, int length);  // index of name or 0
+const char * symbolName(const struct SymbolTable * table, int index);  // valid until the next internSymbol()
+void freeSymbolTable(struct SymbolTable * table);
+
+#endif //SUDOKU_SYMBOL_TABLE_H
@@ -0,0 +1,97 @@
+// Regression tests of the libdpll API, run by ctest
+
+#include <stdio.h>
+#include "dpll_solver.h"
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// Enumeration must leave the formula as it was: a variable added after it,
+// which takes the number the blocking clauses were conditioned on, stays free
+static void test_enumerate_then_add() {
+    solver_t *solver = solver_create();
+    int clause[] = {1, 2};
+    CHECK(solver_add_clause(solver, clause, 2) == SOLVER_OK);
+    CHECK(solver_enumerate(solver, NULL, 0, 2, NULL, NULL) == 2);
+
+    int unit[] = {3};
+    CHECK(solver_add_clause(solver, unit, 1) == SOLVER_OK);
+    CHECK(solver_solve(solver) == SATISFIABLE);
+    CHECK(solver_get_model(solver, 3) == 1);
+
+    // the models of 1 v 2 are all found again
+    CHECK(solver_enumerate(solver, clause, 2, 10, NULL, NULL) == 3);
+    CHECK(solver_solve(solver) == SATISFIABLE);
+    solver_destroy(solver);
+}
+
+// A limit of 2 answers whether the projection has a unique model
+static void test_unique() {
+    solver_t *solver = solver_create();
+    int a[] = {1}, b[] = {-1, 2}, c[] = {3, 4};
+    solver_add_clause(solver, a, 1);
+    solver_add_clause(solver, b, 2);
+    solver_add_clause(solver, c, 2);
+    int projection[] = {1, 2};
+    CHECK(solver_enumerate(solver, projection, 2, 2, NULL, NULL) == 1);
+    CHECK(solver_enumerate(solver, NULL, 0, 2, NULL, NULL) == 2);
+    // the selector is handed back, enumerating leaves no variable behind
+    CHECK(solver_get_model(solver, 5) == -1);
+
+    int contradiction[] = {-2};
+    solver_add_clause(solver, contradiction, 1);
+    CHECK(solver_enumerate(solver, NULL, 0, 2, NULL, NULL) == 0);
+    CHECK(solver_solve(solver) == UNSATISFIABLE);
+    solver_destroy(solver);
+}
+
+// A projected variable in no clause, like a BNF name that only appears in a
+// tautology, is free and doubles the models
+static void test_free_variable() {
+    solver_t *solver = solver_create();
+    int unit[] = {2};
+    solver_add_clause(solver, unit, 1);
+    int projection[] = {1, 2};
+    CHECK(solver_enumerate(solver, projection, 2, 10, NULL, NULL) == 2);
+    CHECK(solver_enumerate(solver, projection + 1, 1, 10, NULL, NULL) == 1);
+
+    int unconstrained[] = {1, 3};
+    CHECK(solver_enumerate(solver, unconstrained, 2, 10, NULL, NULL) == 4);
+    solver_destroy(solver);
+}
+
+// Clauses added between calls are attached against what earlier searches
+// fixed at level 0: here 1 is fixed, so -1 v 2 must imply 2 at once
+static void test_add_after_solve() {
+    solver_t *solver = solver_create();
+    int a[] = {1}, b[] = {-1, 2}, c[] = {-2, -1};
+    solver_add_clause(solver, a, 1);
+    CHECK(solver_solve(solver) == SATISFIABLE);
+    solver_add_clause(solver, b, 2);
+    CHECK(solver_solve(solver) == SATISFIABLE);
+    CHECK(solver_get_model(solver, 2) == 1);
+    solver_add_clause(solver, c, 2);
+    CHECK(solver_solve(solver) == UNSATISFIABLE);
+    CHECK(solver_solve(solver) == UNSATISFIABLE);
+    CHECK(!solver_failed(solver, 1));
+    solver_destroy(solver);
+}
+
+int main() {
+    test_enumerate_then_add();
+    test_unique();
+    test_free_variable();
+    test_add_after_solve();
+    if (failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All API tests passed\n");
+    return 0;
+}